@@ -0,0 +1,171 @@
+/**
+ * @file benchmark.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains the helpers shared by the benchmarks.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_BENCHMARKS_BENCHMARK_HPP
+#define ENDLESSH_REPORT_BENCHMARKS_BENCHMARK_HPP
+
+#include "extensions.hpp"
+
+// stl
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+inline std::atomic<uint64_t> g_allocationCount{0}; //!< The amount of heap allocations made so far
+
+/**
+ * @brief Allocates heap memory and counts the allocation.
+ *
+ * @param size The size of the allocation.
+ * @param alignment The alignment of the allocation, or 0 for that of malloc().
+ *
+ * @return void* The memory, or null if it couldn't be allocated.
+ */
+inline void* allocateCounted(const size_t size, const size_t alignment) {
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) { return std::malloc(size == 0 ? 1 : size); }
+
+    // aligned_alloc() requires the size to be a multiple of the alignment
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+/**
+ * @brief Throws std::bad_alloc if an allocation failed, as the throwing forms of new must.
+ */
+inline void* requireAllocated(void* memory) {
+    if (memory == nullptr) { throw std::bad_alloc(); }
+    return memory;
+}
+
+/*
+ * Every form of new and delete is replaced, so each stage can report how many heap allocations it made. That includes
+ * the aligned forms, which e.g. the std::pmr resources allocate through. Replacing them is only allowed once per
+ * program, so this header must only be included by a benchmark's main translation unit. They're kept out of line,
+ * so GCC doesn't mistake the inlined malloc() and free() for mismatched allocation functions.
+ */
+__attribute__((noinline)) void* operator new(const size_t size) { return requireAllocated(allocateCounted(size, 0)); }
+__attribute__((noinline)) void* operator new[](const size_t size) { return requireAllocated(allocateCounted(size, 0)); }
+__attribute__((noinline)) void* operator new(const size_t size, const std::nothrow_t&) noexcept { return allocateCounted(size, 0); }
+__attribute__((noinline)) void* operator new[](const size_t size, const std::nothrow_t&) noexcept { return allocateCounted(size, 0); }
+__attribute__((noinline)) void* operator new(const size_t size, const std::align_val_t alignment) { return requireAllocated(allocateCounted(size, static_cast<size_t>(alignment))); }
+__attribute__((noinline)) void* operator new[](const size_t size, const std::align_val_t alignment) { return requireAllocated(allocateCounted(size, static_cast<size_t>(alignment))); }
+__attribute__((noinline)) void* operator new(const size_t size, const std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateCounted(size, static_cast<size_t>(alignment)); }
+__attribute__((noinline)) void* operator new[](const size_t size, const std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateCounted(size, static_cast<size_t>(alignment)); }
+
+__attribute__((noinline)) void operator delete(void* memory) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete[](void* memory) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete[](void* memory, std::align_val_t) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete(void* memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete[](void* memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { std::free(memory); }
+
+/**
+ * @brief The tokenization used by the report generator prior to tokenizeEndlesshLine.
+ *
+ * @return size_t A checksum of the tokens; identical to that of the current tokenizer for valid lines.
+ */
+inline size_t legacyTokenize(const string& line) {
+    vector<string> tokens;
+    if (!splitString(line, " ", tokens)) { return 0; }
+
+    string hostToken;
+    string portToken;
+    string timeToken;
+    string bytesToken;
+    bool isAccept = false;
+
+    for (const auto& token : tokens) {
+        if (regexMatch(token.c_str(), R"(host=[^\s])")) {
+            hostToken = token.substr(token.find('=') + 1);
+        } else if (token == "ACCEPT") {
+            isAccept = true;
+        } else if (regexMatch(token.c_str(), R"(port=[^\s])") && token.find('=') != string::npos) {
+            portToken = token.substr(token.find('=') + 1);
+        } else if (regexMatch(token.c_str(), R"(time=[^\s])") && token.find('=') != string::npos) {
+            timeToken = token.substr(token.find('=') + 1);
+        } else if (regexMatch(token.c_str(), R"(bytes=[^\s])") && token.find('=') != string::npos) {
+            bytesToken = token.substr(token.find('=') + 1);
+        }
+    }
+
+    return (hostToken.empty() ? 0 : 1) + (isAccept ? std::stoul(portToken) : std::stoull(bytesToken));
+}
+
+/**
+ * @brief Parses a size such as 4096, 64K, 512M or 10G (binary units).
+ *
+ * @return true If the size was parsed successfully.
+ */
+inline bool parseByteSize(const char* str, uint64_t& bytes) {
+    char* unit = nullptr;
+    bytes = std::strtoull(str, &unit, 10);
+    if (unit == str) { return false; }
+
+    switch (*unit) {
+        case '\0': return true;
+        case 'K': case 'k': bytes <<= 10; break;
+        case 'M': case 'm': bytes <<= 20; break;
+        case 'G': case 'g': bytes <<= 30; break;
+        default: return false;
+    }
+
+    return unit[1] == '\0';
+}
+
+/**
+ * @brief Runs a benchmark stage once and prints its throughput and the amount of heap allocations it made.
+ *
+ * @tparam Stage A callable taking no arguments and returning a checksum, to keep the work from being optimised away.
+ *
+ * @param name The name of the stage.
+ * @param bytes The amount of bytes processed by the stage, or 0 to omit the throughput in bytes.
+ * @param items The amount of items (lines, hosts, ...) processed by the stage, or 0 to omit the throughput in items.
+ * @param stage The stage to run.
+ *
+ * @return double The time the stage took, in seconds.
+ */
+template<typename Stage>
+double runStage(const string_view name, const uint64_t bytes, const uint64_t items, Stage&& stage) {
+    const auto allocationsBefore = g_allocationCount.load(std::memory_order_relaxed);
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t checksum = stage();
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const auto allocations = g_allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+    fmt::print(
+        "{0:<26s} {1:>9.3f}s {2:>16s} {3:>20s} {4:>10d} allocs (checksum {5:d})\n",
+        name, elapsed,
+        bytes == 0 ? string() : fmt::format("{0:.1f} MiB/s", bytes / (1024.0 * 1024.0) / elapsed),
+        items == 0 ? string() : fmt::format("{0:.0f} items/s", items / elapsed),
+        allocations, checksum
+    );
+
+    return elapsed;
+}
+
+#endif // ENDLESSH_REPORT_BENCHMARKS_BENCHMARK_HPP
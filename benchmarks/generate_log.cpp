@@ -0,0 +1,97 @@
+/**
+ * @file generate_log.cpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Writes a deterministic synthetic syslog containing endlessh traffic, e.g. to benchmark the report generator with.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#include "benchmark.hpp"
+#include "loggenerator.hpp"
+
+////////////////////////////////
+//  Standard Includes (STL)   //
+////////////////////////////////
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <getopt.h>
+
+#include <fmt/format.h>
+
+constexpr static const char* USAGE = R"(
+Usage:
+    {0:s} [options] [output file]
+
+Writes a synthetic syslog with endlessh traffic to the output file (default: stdout).
+The same options always produce the same log.
+
+Arguments:
+    -s [n]      The size of the log, e.g. 1M, 512M, 10G (default: 64M)
+    -H [n]      The amount of distinct hosts (default: 10000)
+    -n [r]      The share of lines not from endlessh, 0.0 - 1.0 (default: 0.5)
+    -6 [r]      The share of hosts with an IPv6 address, 0.0 - 1.0 (default: 0.05)
+    -r [n]      The seed (default: fixed)
+)";
+
+int main(int32_t argC, char** argV) {
+    LogGeneratorOptions options;
+    char optVal = 0;
+
+    while ((optVal = getopt(argC, argV, "s:H:n:6:r:h")) != -1) {
+        switch (optVal) {
+            case 's':
+                if (!parseByteSize(optarg, options.targetBytes)) {
+                    fmt::print(stderr, "Invalid size!\n");
+                    return 1;
+                }
+                break;
+            case 'H':
+                options.hostCount = static_cast<uint32_t>(std::strtoul(optarg, nullptr, 10));
+                break;
+            case 'n':
+                options.noiseRatio = std::strtod(optarg, nullptr);
+                break;
+            case '6':
+                options.ipv6Ratio = std::strtod(optarg, nullptr);
+                break;
+            case 'r':
+                options.seed = std::strtoull(optarg, nullptr, 0);
+                break;
+            default:
+                fmt::print(stderr, USAGE, argV[0]);
+                return 1;
+        }
+    }
+
+    if (options.hostCount == 0 || options.noiseRatio < 0 || options.noiseRatio >= 1 || options.ipv6Ratio < 0 || options.ipv6Ratio > 1) {
+        fmt::print(stderr, "The host count must be positive and the ratios must lie within 0.0 - 1.0 (noise: below 1.0)!\n");
+        return 1;
+    }
+
+    auto* output = optind < argC ? std::fopen(argV[optind], "wb") : stdout;
+    if (output == nullptr) {
+        fmt::print(stderr, "Failed to open {0:s}: {1:s}\n", argV[optind], strerror(errno));
+        return 1;
+    }
+
+    bool isWritten = true;
+    SyntheticLogGenerator generator(options);
+    generator.generate([&](const string_view block) {
+        isWritten = isWritten && std::fwrite(block.data(), 1, block.size(), output) == block.size();
+    });
+
+    isWritten = std::fflush(output) == 0 && isWritten;
+    if (output != stdout) { isWritten = std::fclose(output) == 0 && isWritten; }
+
+    if (!isWritten) {
+        fmt::print(stderr, "Failed to write the log: {0:s}\n", strerror(errno));
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,224 @@
+/**
+ * @file loggenerator.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains a deterministic generator of synthetic syslogs containing endlessh traffic.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_BENCHMARKS_LOGGENERATOR_HPP
+#define ENDLESSH_REPORT_BENCHMARKS_LOGGENERATOR_HPP
+
+// stl
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+/**
+ * @brief The parameters of a synthetic log.
+ */
+struct LogGeneratorOptions {
+    uint64_t    targetBytes{64 * 1024 * 1024}; //!< The size of the log to generate; the last line may overshoot it
+    uint32_t    hostCount{10000}; //!< The amount of distinct hosts connecting to the tarpit
+    double      noiseRatio{0.5}; //!< The share of lines which aren't from endlessh (0.0 - 1.0)
+    double      ipv6Ratio{0.05}; //!< The share of hosts with a native IPv6 address (0.0 - 1.0)
+    uint32_t    maxOpenConnections{4096}; //!< The maximum amount of concurrent connections, like endlessh's -m
+    uint64_t    seed{0x454e444c45535348ULL}; //!< The seed; the same options always produce the same log
+};
+
+/**
+ * @brief Generates realistic syslog traffic of an endlessh tarpit, interleaved with other daemons' entries.
+ *
+ * Connections are accepted and later closed with the matching host and port, so the ACCEPT/CLOSE pairing,
+ * time wasted and bytes sent are consistent. Hosts follow a power law: a few of them account for most connections,
+ * as with real scanners. Timestamps increase monotonically in the traditional syslog format.
+ *
+ * The log is produced in blocks of @see BLOCK_SIZE, so arbitrarily large logs can be written without holding them in memory.
+ */
+class SyntheticLogGenerator {
+    public: // +++ Constants +++
+        constexpr static size_t BLOCK_SIZE = 1024 * 1024; //!< The approximate size of the blocks passed to the sink
+
+    public: // +++ Constructor / Destructor +++
+        explicit SyntheticLogGenerator(const LogGeneratorOptions& options): m_options(options), m_state(options.seed) {
+            m_hosts.reserve(options.hostCount);
+
+            for (uint32_t i = 0; i < options.hostCount; i++) {
+                if (nextDouble() < options.ipv6Ratio) {
+                    m_hosts.push_back(fmt::format("2001:db8:{0:x}:{1:x}::{2:x}", next() & 0xffff, next() & 0xffff, next() & 0xffff));
+                } else {
+                    m_hosts.push_back(fmt::format("::ffff:{0:d}.{1:d}.{2:d}.{3:d}", next() % 223 + 1, next() % 256, next() % 256, next() % 254 + 1));
+                }
+            }
+        }
+
+    public: // +++ Generation +++
+        /**
+         * @brief Generates the log.
+         *
+         * @tparam Sink A callable accepting a string_view; called with consecutive blocks of complete lines.
+         *
+         * @param sink The sink to pass the log to.
+         *
+         * @return uint64_t The amount of bytes generated.
+         */
+        template<typename Sink>
+        uint64_t generate(Sink&& sink) {
+            fmt::memory_buffer block;
+            uint64_t bytesGenerated = 0;
+
+            while (bytesGenerated < m_options.targetBytes) {
+                const auto sizeBefore = block.size();
+
+                appendLine(block);
+                bytesGenerated += block.size() - sizeBefore;
+
+                if (block.size() >= BLOCK_SIZE) {
+                    sink(string_view(block.data(), block.size()));
+                    block.clear();
+                }
+            }
+
+            if (block.size() > 0) { sink(string_view(block.data(), block.size())); }
+
+            return bytesGenerated;
+        }
+
+    private: // +++ Implementation +++
+        /**
+         * @brief A connection which has been accepted, but not yet closed.
+         */
+        struct OpenConnection {
+            uint32_t    hostIndex; //!< The connecting host
+            uint16_t    port; //!< The host's source port
+            uint16_t    fd; //!< The file descriptor endlessh uses for the connection
+            uint64_t    acceptTime; //!< When the connection was accepted, in seconds
+        };
+
+        /**
+         * @brief splitmix64; fast, and identical on every platform unlike the standard distributions.
+         */
+        uint64_t next() {
+            auto z = (m_state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        double nextDouble() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+        /**
+         * @brief Picks a host; low indices are picked far more often than high ones.
+         */
+        uint32_t nextHostIndex() {
+            const auto u = nextDouble();
+            return static_cast<uint32_t>(m_options.hostCount * u * u * u) % m_options.hostCount;
+        }
+
+        void appendLine(fmt::memory_buffer& block) {
+            // Anything from a couple of lines per second to a quiet minute
+            m_now += next() % 4 == 0 ? next() % 60 : 0;
+
+            if (nextDouble() < m_options.noiseRatio) {
+                appendNoise(block);
+            } else if (!m_openConnections.empty() && (m_openConnections.size() >= m_options.maxOpenConnections || next() % 2 == 0)) {
+                appendClose(block);
+            } else {
+                appendAccept(block);
+            }
+        }
+
+        void appendPrefix(fmt::memory_buffer& block, const string_view process) {
+            constexpr static const char* MONTHS[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+            // A year of 360 days keeps the calendar arithmetic trivial; the dates only need to increase
+            const auto dayOfYear = (m_now / 86400) % 360;
+            fmt::format_to(
+                std::back_inserter(block), "{0:s} {1:>2d} {2:02d}:{3:02d}:{4:02d} tarpit {5:s}: ",
+                MONTHS[dayOfYear / 30], dayOfYear % 30 + 1, (m_now / 3600) % 24, (m_now / 60) % 60, m_now % 60, process
+            );
+        }
+
+        void appendEndlesshTimestamp(fmt::memory_buffer& block) {
+            const auto dayOfYear = (m_now / 86400) % 360;
+            fmt::format_to(
+                std::back_inserter(block), "2023-{0:02d}-{1:02d}T{2:02d}:{3:02d}:{4:02d}.{5:03d}Z ",
+                dayOfYear / 30 + 1, dayOfYear % 30 + 1, (m_now / 3600) % 24, (m_now / 60) % 60, m_now % 60, next() % 1000
+            );
+        }
+
+        void appendAccept(fmt::memory_buffer& block) {
+            const OpenConnection connection{ nextHostIndex(), static_cast<uint16_t>(next() % 64511 + 1024), static_cast<uint16_t>(next() % 4096 + 4), m_now };
+            m_openConnections.push_back(connection);
+
+            appendPrefix(block, "endlessh[812]");
+            appendEndlesshTimestamp(block);
+            fmt::format_to(
+                std::back_inserter(block), "ACCEPT host={0:s} port={1:d} fd={2:d} n={3:d}/{4:d}\n",
+                m_hosts[connection.hostIndex], connection.port, connection.fd, m_openConnections.size(), m_options.maxOpenConnections
+            );
+        }
+
+        void appendClose(fmt::memory_buffer& block) {
+            // Close a random connection; swap-remove keeps this O(1)
+            const auto index = next() % m_openConnections.size();
+            const auto connection = m_openConnections[index];
+            m_openConnections[index] = m_openConnections.back();
+            m_openConnections.pop_back();
+
+            // endlessh sends a line every 10 seconds by default, of up to 32 bytes
+            const auto seconds = m_now - connection.acceptTime;
+            const auto milliseconds = next() % 1000;
+
+            appendPrefix(block, "endlessh[812]");
+            appendEndlesshTimestamp(block);
+            fmt::format_to(
+                std::back_inserter(block), "CLOSE host={0:s} port={1:d} fd={2:d} time={3:d}.{4:03d} bytes={5:d}\n",
+                m_hosts[connection.hostIndex], connection.port, connection.fd, seconds, milliseconds, (seconds / 10 + 1) * (next() % 32 + 1)
+            );
+        }
+
+        void appendNoise(fmt::memory_buffer& block) {
+            switch (next() % 5) {
+                case 0:
+                    appendPrefix(block, "sshd[2231]");
+                    fmt::format_to(std::back_inserter(block), "Invalid user admin from {0:d}.{1:d}.{2:d}.{3:d} port {4:d}\n", next() % 223 + 1, next() % 256, next() % 256, next() % 254 + 1, next() % 64511 + 1024);
+                    break;
+                case 1:
+                    appendPrefix(block, "CRON[4120]");
+                    fmt::format_to(std::back_inserter(block), "(root) CMD (   cd / && run-parts --report /etc/cron.hourly)\n");
+                    break;
+                case 2:
+                    appendPrefix(block, "kernel");
+                    fmt::format_to(std::back_inserter(block), "[{0:d}.{1:06d}] [UFW BLOCK] IN=eth0 OUT= SRC={2:d}.{3:d}.{4:d}.{5:d} PROTO=TCP DPT=23\n", m_now, next() % 1000000, next() % 223 + 1, next() % 256, next() % 256, next() % 254 + 1);
+                    break;
+                case 3:
+                    appendPrefix(block, "systemd[1]");
+                    fmt::format_to(std::back_inserter(block), "Started Session {0:d} of user simon.\n", next() % 100000);
+                    break;
+                default:
+                    appendPrefix(block, "postfix/smtpd[3120]");
+                    fmt::format_to(std::back_inserter(block), "disconnect from unknown[{0:d}.{1:d}.{2:d}.{3:d}] ehlo=1 quit=1 commands=2\n", next() % 223 + 1, next() % 256, next() % 256, next() % 254 + 1);
+                    break;
+            }
+        }
+
+    private: // +++ Members +++
+        LogGeneratorOptions     m_options; //!< The parameters of the log
+        uint64_t                m_state; //!< The state of the random number generator
+        uint64_t                m_now{0}; //!< The current time in the log, in seconds since the start of the year
+        vector<string>          m_hosts; //!< The addresses of the hosts
+        vector<OpenConnection>  m_openConnections; //!< The connections accepted but not yet closed
+};
+
+#endif // ENDLESSH_REPORT_BENCHMARKS_LOGGENERATOR_HPP
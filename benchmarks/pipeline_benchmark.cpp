@@ -0,0 +1,281 @@
+/**
+ * @file pipeline_benchmark.cpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Benchmarks each stage of the report generator (reading, filtering, tokenizing, aggregation and rendering) on a synthetic or given log.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#include "aggregator.hpp"
+#include "benchmark.hpp"
+#include "extensions.hpp"
+#include "ipstats.hpp"
+#include "loggenerator.hpp"
+#include "logreader.hpp"
+#include "reportwriter.hpp"
+#include "tokenizer.hpp"
+
+////////////////////////////////
+//  Standard Includes (STL)   //
+////////////////////////////////
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+const static string_view ENDLESSH = "endlessh"; //!< The tag identifying endlessh's entries in the log
+
+constexpr static const char* USAGE = R"(
+Usage:
+    {0:s} [options] [log file]
+
+Benchmarks each stage of the report generator on the given log, or on a synthetic log (see -s, -H and -n).
+
+Arguments:
+    -s [n]      The size of the synthetic log, e.g. 1M, 512M, 10G (default: 64M)
+    -H [n]      The amount of distinct hosts in the synthetic log (default: 10000)
+    -n [r]      The share of lines not from endlessh in the synthetic log, 0.0 - 1.0 (default: 0.5)
+    -t [n]      The maximum amount of lines to tokenize (default: 1000000)
+    -l [n]      The maximum amount of lines to tokenize with the legacy tokenizer; it's slow (default: 20000)
+)";
+
+static bool generateLogFile(const LogGeneratorOptions&, string&); //!< Writes a synthetic log to a temporary file
+
+int main(int32_t argC, char** argV) {
+    LogGeneratorOptions options;
+    size_t maxTokenizedLines = 1000000;
+    size_t maxLegacyLines = 20000;
+    char optVal = 0;
+
+    while ((optVal = getopt(argC, argV, "s:H:n:t:l:h")) != -1) {
+        switch (optVal) {
+            case 's':
+                if (!parseByteSize(optarg, options.targetBytes)) {
+                    fmt::print(stderr, "Invalid size!\n");
+                    return 1;
+                }
+                break;
+            case 'H':
+                options.hostCount = static_cast<uint32_t>(std::strtoul(optarg, nullptr, 10));
+                break;
+            case 'n':
+                options.noiseRatio = std::strtod(optarg, nullptr);
+                break;
+            case 't':
+                maxTokenizedLines = std::strtoull(optarg, nullptr, 10);
+                break;
+            case 'l':
+                maxLegacyLines = std::strtoull(optarg, nullptr, 10);
+                break;
+            default:
+                fmt::print(stderr, USAGE, argV[0]);
+                return 1;
+        }
+    }
+
+    if (options.hostCount == 0 || options.noiseRatio < 0 || options.noiseRatio >= 1) {
+        fmt::print(stderr, "The host count must be positive and the noise ratio must lie within 0.0 - 1.0!\n");
+        return 1;
+    }
+
+    // +++ Generating +++
+    string logPath;
+    const auto isSynthetic = optind >= argC;
+
+    if (isSynthetic) {
+        fmt::print("Generating a {0:s} log with {1:d} hosts and {2:.0f}% noise...\n", getHumanReadableBytes(options.targetBytes), options.hostCount, options.noiseRatio * 100);
+        if (!generateLogFile(options, logPath)) { return 1; }
+    } else {
+        logPath = argV[optind];
+    }
+
+    LogReader reader;
+    const auto isOpen = reader.open(logPath);
+    const auto openError = errno;
+
+    // The mapping stays valid after the file is removed
+    if (isSynthetic) { unlink(logPath.c_str()); }
+
+    if (!isOpen || !reader.isMapped()) {
+        fmt::print(stderr, "Failed to map {0:s}: {1:s}\n", logPath, isOpen ? "not a regular, uncompressed file" : strerror(openError));
+        return 1;
+    }
+
+    const auto log = reader.getMappedInput();
+
+    // +++ Reading +++
+    uint64_t lineCount = 0;
+    runStage("read", log.size(), 0, [&]() {
+        uint64_t totalLength = 0;
+        LogReader::forEachLineIn(log, [&](const string_view line) { lineCount++; totalLength += line.size(); });
+        return totalLength;
+    });
+
+    // +++ Filtering +++
+    uint64_t endlesshLineCount = 0;
+    runStage("filter", log.size(), lineCount, [&]() {
+        LogReader::forEachLineContainingIn(log, ENDLESSH, [&](const string_view) { endlesshLineCount++; });
+        return endlesshLineCount;
+    });
+
+    runStage("filter (per line)", log.size(), lineCount, [&]() {
+        uint64_t matchingLines = 0;
+        LogReader::forEachLineIn(log, [&](const string_view line) { matchingLines += findTag(line.data(), line.size(), ENDLESSH) != nullptr ? 1 : 0; });
+        return matchingLines;
+    });
+
+    // +++ Tokenizing +++
+    // Only valid entries are sampled; the legacy tokenizer throws on anything else
+    vector<string_view> sampleLines;
+    EndlesshEvent event;
+
+    sampleLines.reserve(std::min<uint64_t>(maxTokenizedLines, endlesshLineCount));
+    LogReader::forEachLineContainingIn(log, ENDLESSH, [&](const string_view line) {
+        if (sampleLines.size() < maxTokenizedLines && tokenizeEndlesshLine(line, event)) { sampleLines.push_back(line); }
+    });
+
+    uint64_t sampleBytes = 0;
+    for (const auto& line : sampleLines) { sampleBytes += line.size() + 1; }
+
+    const vector<string> legacyLines(sampleLines.begin(), sampleLines.begin() + std::min(maxLegacyLines, sampleLines.size()));
+    uint64_t legacyBytes = 0;
+    for (const auto& line : legacyLines) { legacyBytes += line.size() + 1; }
+
+    uint64_t legacyChecksum = 0;
+    runStage("tokenize (legacy)", legacyBytes, legacyLines.size(), [&]() {
+        for (const auto& line : legacyLines) { legacyChecksum += legacyTokenize(line); }
+        return legacyChecksum;
+    });
+
+    uint64_t legacySampleChecksum = 0;
+    runStage("tokenize", sampleBytes, sampleLines.size(), [&]() {
+        uint64_t checksum = 0;
+
+        for (size_t i = 0; i < sampleLines.size(); i++) {
+            if (i == legacyLines.size()) { legacySampleChecksum = checksum; }
+            if (tokenizeEndlesshLine(sampleLines[i], event)) {
+                checksum += 1 + (event.type == EndlesshEventType::Accept ? event.port : event.bytes);
+            }
+        }
+
+        if (legacyLines.size() == sampleLines.size()) { legacySampleChecksum = checksum; }
+        return checksum;
+    });
+
+    if (legacySampleChecksum != legacyChecksum) {
+        fmt::print(stderr, "Checksum mismatch between tokenizers!\n");
+        return 1;
+    }
+
+    // +++ Aggregation +++
+    ConnectionAggregator basicAggregator(false);
+    runStage("aggregate", log.size(), endlesshLineCount, [&]() {
+        LogReader::forEachLineContainingIn(log, ENDLESSH, [&](const string_view line) { basicAggregator.addLine(line); });
+        return basicAggregator.getUniqueHosts();
+    });
+
+    ConnectionAggregator detailedAggregator(true);
+    runStage("aggregate (detailed)", log.size(), endlesshLineCount, [&]() {
+        LogReader::forEachLineContainingIn(log, ENDLESSH, [&](const string_view line) { detailedAggregator.addLine(line); });
+        return detailedAggregator.getUniqueHosts();
+    });
+
+    // Once all hosts are known, aggregating must not allocate at all
+    runStage("aggregate (warm)", log.size(), endlesshLineCount, [&]() {
+        LogReader::forEachLineContainingIn(log, ENDLESSH, [&](const string_view line) { basicAggregator.addLine(line); });
+        return basicAggregator.getUniqueHosts();
+    });
+
+    runStage("aggregate (detailed, warm)", log.size(), endlesshLineCount, [&]() {
+        LogReader::forEachLineContainingIn(log, ENDLESSH, [&](const string_view line) { detailedAggregator.addLine(line); });
+        return detailedAggregator.getUniqueHosts();
+    });
+
+    // +++ Rendering +++
+    auto* devNull = std::fopen("/dev/null", "wb");
+    if (devNull == nullptr) {
+        fmt::print(stderr, "Failed to open /dev/null: {0:s}\n", strerror(errno));
+        return 1;
+    }
+
+    runStage("render", 0, basicAggregator.getUniqueHosts(), [&]() {
+        ReportWriter writer(devNull);
+        printIpStatsTableHeader(writer, false);
+        printIpStats(writer, basicAggregator.getConnections(), RankingField::None, SIZE_MAX);
+        return basicAggregator.getUniqueHosts();
+    });
+
+    runStage("render (detailed)", 0, detailedAggregator.getUniqueHosts(), [&]() {
+        ReportWriter writer(devNull);
+        printIpStatsTableHeader(writer, true);
+        printDetailedIpStats(writer, detailedAggregator.getDetailedConnections(), RankingField::None, SIZE_MAX);
+        return detailedAggregator.getUniqueHosts();
+    });
+
+    runStage("render (detailed, top 100)", 0, detailedAggregator.getUniqueHosts(), [&]() {
+        ReportWriter writer(devNull);
+        printIpStatsTableHeader(writer, true);
+        printDetailedIpStats(writer, detailedAggregator.getDetailedConnections(), RankingField::Accepted, 100);
+        return detailedAggregator.getUniqueHosts();
+    });
+
+    std::fclose(devNull);
+
+    fmt::print(
+        "{0:s} in {1:d} lines, {2:d} from endlessh, {3:d} hosts\n",
+        getHumanReadableBytes(log.size()), lineCount, endlesshLineCount, detailedAggregator.getUniqueHosts()
+    );
+
+    return 0;
+}
+
+/**
+ * @brief Writes a synthetic log to a temporary file.
+ *
+ * @param options The parameters of the log.
+ * @param path Will contain the path of the file.
+ *
+ * @return true If the log was written successfully.
+ * @return false Otherwise.
+ */
+bool generateLogFile(const LogGeneratorOptions& options, string& path) {
+    const auto* tempDir = std::getenv("TMPDIR");
+    path = fmt::format("{0:s}/endlessh-report-benchmark.XXXXXX", tempDir == nullptr ? "/tmp" : tempDir);
+
+    const auto fd = mkstemp(path.data());
+    auto* output = fd < 0 ? nullptr : fdopen(fd, "wb");
+    if (output == nullptr) {
+        fmt::print(stderr, "Failed to create {0:s}: {1:s}\n", path, strerror(errno));
+        return false;
+    }
+
+    bool isWritten = true;
+    SyntheticLogGenerator generator(options);
+    runStage("generate", options.targetBytes, 0, [&]() {
+        return generator.generate([&](const string_view block) {
+            isWritten = isWritten && std::fwrite(block.data(), 1, block.size(), output) == block.size();
+        });
+    });
+
+    if (std::fclose(output) != 0 || !isWritten) {
+        fmt::print(stderr, "Failed to write {0:s}: {1:s}\n", path, strerror(errno));
+        unlink(path.c_str());
+        return false;
+    }
+
+    return true;
+}
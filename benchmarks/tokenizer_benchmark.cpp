@@ -0,0 +1,108 @@
+/**
+ * @file tokenizer_benchmark.cpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Micro-benchmark comparing the legacy splitString/regexMatch tokenization with tokenizeEndlesshLine.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#include "benchmark.hpp"
+#include "tokenizer.hpp"
+
+////////////////////////////////
+//  Standard Includes (STL)   //
+////////////////////////////////
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+using fmt::format;
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+using std::string;
+using std::string_view;
+using std::vector;
+
+/**
+ * @brief Generates a deterministic set of endlessh ACCEPT/CLOSE lines.
+ *
+ * @param lineCount The amount of lines to generate.
+ *
+ * @return vector<string> The generated lines.
+ */
+static vector<string> generateLines(const size_t lineCount) {
+    vector<string> lines;
+    lines.reserve(lineCount);
+
+    uint32_t seed = 0x1234567;
+    auto nextRandom = [&]() { seed = seed * 1103515245 + 12345; return (seed >> 8) & 0xffff; };
+
+    for (size_t i = 0; i < lineCount; i++) {
+        const auto host = format("::ffff:{0:d}.{1:d}.{2:d}.{3:d}", nextRandom() % 223 + 1, nextRandom() % 256, nextRandom() % 256, nextRandom() % 254 + 1);
+        const auto port = nextRandom() % 64511 + 1024;
+
+        if (i % 2 == 0) {
+            lines.push_back(format("Oct 16 12:00:01 box endlessh[512]: 2022-10-16T12:00:01.123Z ACCEPT host={0:s} port={1:d} fd=4 n=1/4096", host, port));
+        } else {
+            lines.push_back(format("Oct 16 12:00:01 box endlessh[512]: 2022-10-16T12:00:01.123Z CLOSE host={0:s} port={1:d} fd=4 time={2:d}.{3:03d} bytes={4:d}", host, port, nextRandom() % 5000, nextRandom() % 1000, nextRandom() * 3));
+        }
+    }
+
+    return lines;
+}
+
+/**
+ * @brief Tokenizes the lines using tokenizeEndlesshLine.
+ */
+static size_t scannerTokenize(const string& line) {
+    EndlesshEvent event;
+    if (!tokenizeEndlesshLine(line, event)) { return 0; }
+
+    return 1 + (event.type == EndlesshEventType::Accept ? event.port : event.bytes);
+}
+
+/**
+ * @brief Runs a tokenizer over all lines and prints the throughput and the amount of heap allocations it made.
+ *
+ * @return size_t A checksum of the results, to keep the work from being optimised away.
+ */
+template<typename Tokenizer>
+static size_t runBenchmark(const string_view name, const vector<string>& lines, Tokenizer tokenizer) {
+    size_t checksum = 0;
+
+    const auto allocationsBefore = g_allocationCount.load(std::memory_order_relaxed);
+    const auto start = steady_clock::now();
+    for (const auto& line : lines) {
+        checksum += tokenizer(line);
+    }
+    const auto elapsed = duration<double>(steady_clock::now() - start).count();
+    const auto allocations = g_allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+    fmt::print(
+        "{0:<10s} {1:>10d} lines in {2:>8.3f}s = {3:>14.0f} lines/s, {4:>10d} allocs (checksum {5:d})\n",
+        name, lines.size(), elapsed, lines.size() / elapsed, allocations, checksum
+    );
+
+    return checksum;
+}
+
+int main(int32_t argC, char** argV) {
+    const size_t lineCount = argC > 1 ? std::strtoull(argV[1], nullptr, 10) : 100000;
+    const auto lines = generateLines(lineCount);
+
+    const auto legacyChecksum = runBenchmark("legacy", lines, legacyTokenize);
+    const auto scannerChecksum = runBenchmark("scanner", lines, scannerTokenize);
+
+    if (legacyChecksum != scannerChecksum) {
+        fmt::print(stderr, "Checksum mismatch between tokenizers!\n");
+        return 1;
+    }
+
+    return 0;
+}
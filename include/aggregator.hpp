@@ -0,0 +1,371 @@
+/**
+ * @file aggregator.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains the streaming aggregation of endlessh log lines into per-host statistics.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_AGGREGATOR_HPP
+#define ENDLESSH_REPORT_INCLUDE_AGGREGATOR_HPP
+
+#include "connectiontracker.hpp"
+#include "hosttable.hpp"
+#include "ipaddress.hpp"
+#include "serialization.hpp"
+#include "sketch.hpp"
+#include "tokenizer.hpp"
+
+// stl
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+
+using std::pair;
+using std::unique_ptr;
+using std::string_view;
+
+/**
+ * @brief Contains the totals over all hosts.
+ */
+struct ConnectionTotals {
+    size_t      acceptedConnections{0}; //!< The total amount of accepted connections
+    size_t      closedConnections{0}; //!< The total amount of closed connections
+    uint64_t    totalMillisecondsWasted{0}; //!< The total milliseconds of bot time wasted
+    size_t      totalBytesSent{0}; //!< The total amount of bytes sent to the bots
+
+    /**
+     * @brief Gets the total seconds of bot time wasted.
+     */
+    double getSecondsWasted() const { return totalMillisecondsWasted / 1000.0; }
+
+    /**
+     * @brief Adds another set of totals to this one.
+     */
+    ConnectionTotals& operator+=(const ConnectionTotals& other) {
+        acceptedConnections += other.acceptedConnections;
+        closedConnections += other.closedConnections;
+        totalMillisecondsWasted += other.totalMillisecondsWasted;
+        totalBytesSent += other.totalBytesSent;
+        return *this;
+    }
+};
+
+/**
+ * @brief Aggregates endlessh log lines into per-host statistics as they are read.
+ *
+ * Each line is tokenized and folded into the aggregates the moment it's passed in, and may be discarded afterwards.
+ * Memory therefore scales with the amount of unique hosts, not with the amount of lines read.
+ * The totals over all hosts are kept up-to-date along the way, so they never need to be recomputed.
+ *
+ * In approximate mode, the hosts are summarised in a fixed amount of memory instead (@see ApproximateHostStatistics);
+ * only the totals remain exact. Connections aren't paired up in that mode, so the open ones are estimated from the totals.
+ */
+class ConnectionAggregator {
+    public: // +++ Types +++
+        using ConnectionMap = std::pmr::map<IpAddress, pair<uint32_t, uint32_t>>; //!< Host -> (accepted, closed)
+
+    public: // +++ Constructor / Destructor +++
+        /**
+         * @param detailed Whether to collect detailed statistics (@see ConnectionDetails) or the basic accepted/closed counts.
+         * @param approximate Whether to estimate the statistics per host in a fixed amount of memory. Excludes detailed.
+         */
+        explicit ConnectionAggregator(const bool detailed, const bool approximate = false):
+            m_detailed(detailed && !approximate),
+            m_basicConnections(std::make_unique<BasicConnections>()),
+            m_approximateStatistics(approximate ? std::make_unique<ApproximateHostStatistics>() : nullptr) {}
+        ConnectionAggregator(ConnectionAggregator&&) = default;
+        ConnectionAggregator& operator=(ConnectionAggregator&&) = default;
+        ~ConnectionAggregator() = default;
+
+    public: // +++ Aggregation +++
+        /**
+         * @brief Tokenizes an endlessh log line and adds it to the aggregates.
+         *
+         * @param line The line to add. Lines without a valid host= token are ignored.
+         */
+        void addLine(const string_view line) {
+            if (tokenizeEndlesshLine(line, m_event)) {
+                addEvent(m_event);
+            }
+        }
+
+        /**
+         * @brief Adds a tokenized event to the aggregates.
+         *
+         * @param event The event to add. Events which are neither an ACCEPT nor a CLOSE are ignored.
+         */
+        void addEvent(const EndlesshEvent& event) {
+            if (event.type == EndlesshEventType::Unknown) { return; }
+
+            // Tracking the connections would take up several MiB on its own, so approximate mode leaves it out
+            if (m_approximateStatistics) { return addApproximateEvent(event); }
+
+            if (event.type == EndlesshEventType::Accept) {
+                m_tracker.onAccept({ event.host, event.port });
+            } else {
+                m_tracker.onClose({ event.host, event.port });
+            }
+
+            if (m_detailed) {
+                addDetailedEvent(event);
+            } else {
+                addBasicEvent(event);
+            }
+        }
+
+        /**
+         * @brief Merges the aggregates of another aggregator into this one.
+         *
+         * Merging the partial results of consecutive parts of a log in order gives the exact same
+         * result as aggregating the whole log in one go, including the order of the hosts
+         * and the pairing of connections spanning both parts.
+         *
+         * @param other The aggregator to merge. Must use the same mode as this aggregator.
+         */
+        void merge(const ConnectionAggregator& other) {
+            for (const auto& connection : other.m_basicConnections->hosts) {
+                auto& counts = m_basicConnections->hosts[connection.first];
+                counts.first += connection.second.first;
+                counts.second += connection.second.second;
+            }
+
+            for (const auto& details : other.m_detailedConnections) {
+                auto& element = m_detailedConnections.findOrInsert(details.host);
+                element.acceptedConnections += details.acceptedConnections;
+                element.closedConnections += details.closedConnections;
+                element.usedPorts.merge(details.usedPorts);
+                element.totalMillisecondsWasted += details.totalMillisecondsWasted;
+                element.totalBytesSent += details.totalBytesSent;
+            }
+
+            if (m_approximateStatistics && other.m_approximateStatistics) {
+                m_approximateStatistics->merge(*other.m_approximateStatistics);
+            }
+
+            m_totals += other.m_totals;
+            m_tracker.merge(other.m_tracker);
+        }
+
+    public: // +++ Serialization +++
+        /**
+         * @brief Serializes the aggregates, so they can be restored (and added to) later.
+         *
+         * The estimates of approximate mode aren't serialized.
+         *
+         * @param writer The writer to serialize to.
+         */
+        void serialize(BinaryWriter& writer) const {
+            writer.writeByte(m_detailed ? 1 : 0);
+            writer.writeVarInt(m_totals.acceptedConnections);
+            writer.writeVarInt(m_totals.closedConnections);
+            writer.writeVarInt(m_totals.totalMillisecondsWasted);
+            writer.writeVarInt(m_totals.totalBytesSent);
+            writer.writeVarInt(getUniqueHosts());
+
+            for (const auto& connection : m_basicConnections->hosts) {
+                writeAddress(writer, connection.first);
+                writer.writeVarInt(connection.second.first);
+                writer.writeVarInt(connection.second.second);
+            }
+
+            for (const auto& details : m_detailedConnections) {
+                writeAddress(writer, details.host);
+                writer.writeVarInt(details.acceptedConnections);
+                writer.writeVarInt(details.closedConnections);
+                writer.writeVarInt(details.totalMillisecondsWasted);
+                writer.writeVarInt(details.totalBytesSent);
+                writer.writeVarInt(details.usedPorts.size());
+
+                // The ports are in ascending order, so only the (small) gaps between them are written
+                uint16_t previousPort = 0;
+                details.usedPorts.forEach([&writer, &previousPort](const uint16_t port) {
+                    writer.writeVarInt(port - previousPort);
+                    previousPort = port;
+                });
+            }
+
+            m_tracker.serialize(writer);
+        }
+
+        /**
+         * @brief Deserializes aggregates written by @see serialize and adds them to this aggregator.
+         *
+         * @param reader The reader to deserialize from.
+         *
+         * @return true If the aggregates were read successfully.
+         * @return false If the data is corrupt or was written in a different mode (basic/detailed).
+         *         The aggregator may contain part of the data in this case and should be discarded.
+         */
+        bool deserialize(BinaryReader& reader) {
+            if ((reader.readByte() == 1) != m_detailed) { return false; }
+
+            ConnectionTotals totals;
+            totals.acceptedConnections = reader.readVarInt();
+            totals.closedConnections = reader.readVarInt();
+            totals.totalMillisecondsWasted = reader.readVarInt();
+            totals.totalBytesSent = reader.readVarInt();
+
+            const auto hostCount = reader.readVarInt();
+
+            for (uint64_t i = 0; i < hostCount && reader.isGood(); i++) {
+                const auto host = readAddress(reader);
+
+                if (!m_detailed) {
+                    auto& counts = m_basicConnections->hosts[host];
+                    counts.first += static_cast<uint32_t>(reader.readVarInt());
+                    counts.second += static_cast<uint32_t>(reader.readVarInt());
+                    continue;
+                }
+
+                auto& element = m_detailedConnections.findOrInsert(host);
+                element.acceptedConnections += reader.readVarInt();
+                element.closedConnections += reader.readVarInt();
+                element.totalMillisecondsWasted += reader.readVarInt();
+                element.totalBytesSent += reader.readVarInt();
+
+                const auto portCount = reader.readVarInt();
+                uint64_t port = 0;
+                for (uint64_t j = 0; j < portCount && reader.isGood(); j++) {
+                    port += reader.readVarInt();
+                    element.usedPorts.insert(static_cast<uint16_t>(port));
+                }
+            }
+
+            m_totals += totals;
+
+            return reader.isGood() && m_tracker.deserialize(reader);
+        }
+
+    public: // +++ Results +++
+        bool                    isDetailed() const { return m_detailed; }
+        bool                    isApproximate() const { return m_approximateStatistics != nullptr; }
+        const ConnectionMap&    getConnections() const { return m_basicConnections->hosts; } //!< The basic statistics; empty in detailed mode
+        const HostTable&        getDetailedConnections() const { return m_detailedConnections; } //!< The detailed statistics; empty in basic mode
+        const ConnectionTotals& getTotals() const { return m_totals; }
+        const ConnectionTracker& getConnectionTracker() const { return m_tracker; } //!< The connections paired up by host and port; empty in approximate mode
+        const ApproximateHostStatistics* getApproximateStatistics() const { return m_approximateStatistics.get(); } //!< The estimated statistics; null unless approximate
+
+        /**
+         * @brief Gets the amount of unique hosts; an estimate in approximate mode.
+         */
+        size_t getUniqueHosts() const {
+            if (m_approximateStatistics) { return m_approximateStatistics->getUniqueHosts(); }
+
+            return m_detailed ? m_detailedConnections.size() : m_basicConnections->hosts.size();
+        }
+
+        /**
+         * @brief Gets the amount of connections which are still open; an estimate in approximate mode.
+         */
+        size_t getOpenConnections() const {
+            if (!m_approximateStatistics) { return m_tracker.getOpenConnections(); }
+
+            return m_totals.acceptedConnections > m_totals.closedConnections ? m_totals.acceptedConnections - m_totals.closedConnections : 0;
+        }
+
+    private: // +++ Implementation +++
+        /**
+         * @brief Writes an address; IPv4(-mapped) addresses only take up four bytes.
+         */
+        static void writeAddress(BinaryWriter& writer, const IpAddress& address) {
+            uint8_t bytes[16];
+            address.toBytes(bytes);
+
+            if (address.isV4()) {
+                writer.writeByte(4);
+                writer.writeBytes(string_view(reinterpret_cast<const char*>(bytes + 12), 4));
+            } else {
+                writer.writeByte(6);
+                writer.writeBytes(string_view(reinterpret_cast<const char*>(bytes), 16));
+            }
+        }
+
+        static IpAddress readAddress(BinaryReader& reader) {
+            uint8_t bytes[16] = { 0 };
+
+            if (reader.readByte() == 4) {
+                const auto v4Bytes = reader.readBytes(4);
+                if (v4Bytes.size() == 4) { memcpy(bytes + 12, v4Bytes.data(), 4); }
+                bytes[10] = bytes[11] = 0xff;
+            } else {
+                const auto v6Bytes = reader.readBytes(16);
+                if (v6Bytes.size() == 16) { memcpy(bytes, v6Bytes.data(), 16); }
+            }
+
+            return IpAddress::fromBytes(bytes);
+        }
+
+        void addBasicEvent(const EndlesshEvent& event) {
+            auto& counts = m_basicConnections->hosts[event.host];
+
+            if (event.type == EndlesshEventType::Accept) {
+                counts.first++;
+                m_totals.acceptedConnections++;
+            } else {
+                counts.second++;
+                m_totals.closedConnections++;
+            }
+        }
+
+        void addApproximateEvent(const EndlesshEvent& event) {
+            if (event.type == EndlesshEventType::Accept) {
+                m_approximateStatistics->addAccept(event.host);
+                m_totals.acceptedConnections++;
+            } else {
+                m_approximateStatistics->addClose(event.host);
+                m_totals.closedConnections++;
+            }
+        }
+
+        void addDetailedEvent(const EndlesshEvent& event) {
+            auto& element = m_detailedConnections.findOrInsert(event.host);
+
+            if (event.type == EndlesshEventType::Accept) {
+                element.acceptedConnections++;
+                element.usedPorts.insert(event.port);
+                m_totals.acceptedConnections++;
+                return;
+            }
+
+            element.closedConnections++;
+            element.totalBytesSent += event.bytes;
+            element.totalMillisecondsWasted += event.timeMs;
+
+            m_totals.closedConnections++;
+            m_totals.totalBytesSent += event.bytes;
+            m_totals.totalMillisecondsWasted += event.timeMs;
+        }
+
+    private: // +++ Types +++
+        /**
+         * @brief The basic statistics, whose nodes are allocated from a monotonic arena kept alongside them.
+         *
+         * Hosts are never removed, so the arena only ever grows, taking memory from the heap in ever larger blocks
+         * instead of once per host. Both live on the heap together, so moving the aggregator never separates the map
+         * from its arena.
+         */
+        struct BasicConnections {
+            std::pmr::monotonic_buffer_resource arena; //!< The memory the nodes of the map are allocated from
+            ConnectionMap                       hosts{&arena}; //!< Host -> (accepted, closed)
+        };
+
+    private: // +++ Members +++
+        bool                m_detailed; //!< Whether detailed statistics are collected
+        EndlesshEvent       m_event; //!< Scratch event, reused for every line
+
+        unique_ptr<BasicConnections> m_basicConnections; //!< The basic statistics
+        HostTable           m_detailedConnections; //!< The detailed statistics
+        unique_ptr<ApproximateHostStatistics> m_approximateStatistics; //!< The estimated statistics, in approximate mode
+
+        ConnectionTotals    m_totals; //!< The totals over all hosts
+        ConnectionTracker   m_tracker; //!< Pairs ACCEPTs and CLOSEs into connections
+};
+
+#endif // ENDLESSH_REPORT_INCLUDE_AGGREGATOR_HPP
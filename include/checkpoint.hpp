@@ -0,0 +1,86 @@
+/**
+ * @file checkpoint.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains the state file used to resume reading a log where a previous run left off.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_CHECKPOINT_HPP
+#define ENDLESSH_REPORT_INCLUDE_CHECKPOINT_HPP
+
+#include "aggregator.hpp"
+#include "serialization.hpp"
+
+// stl
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using std::string;
+using std::string_view;
+
+/**
+ * @brief Identifies how far a log file has been read.
+ */
+struct LogCheckpoint {
+    uint64_t    device{0}; //!< The device the log resides on
+    uint64_t    inode{0}; //!< The inode of the log; changes when the log is rotated
+    uint64_t    offset{0}; //!< The offset just past the last complete line that was read
+
+    bool isValid() const { return inode != 0; }
+};
+
+constexpr string_view   STATE_FILE_MAGIC = "ERGSTATE"; //!< Identifies a state file
+constexpr uint8_t       STATE_FILE_VERSION = 3; //!< The current version of the state file format
+
+/**
+ * @brief Saves the checkpoint and the aggregates collected so far to a state file.
+ *
+ * @param path The path of the state file. It is replaced atomically.
+ * @param checkpoint The position in the log the aggregates are valid up to.
+ * @param aggregator The aggregates.
+ *
+ * @return true If the state file was written successfully.
+ * @return false Otherwise.
+ */
+inline bool saveStateFile(const string& path, const LogCheckpoint& checkpoint, const ConnectionAggregator& aggregator) {
+    BinaryWriter writer;
+
+    writer.writeBytes(STATE_FILE_MAGIC);
+    writer.writeByte(STATE_FILE_VERSION);
+    writer.writeVarInt(checkpoint.device);
+    writer.writeVarInt(checkpoint.inode);
+    writer.writeVarInt(checkpoint.offset);
+    aggregator.serialize(writer);
+
+    return writer.writeToFile(path);
+}
+
+/**
+ * @brief Loads the checkpoint and aggregates from a state file.
+ *
+ * @param path The path of the state file.
+ * @param checkpoint Will contain the checkpoint.
+ * @param aggregator The aggregator to add the aggregates to. Should be empty, and must be discarded if loading fails.
+ *
+ * @return true If the state file was loaded successfully.
+ * @return false If it doesn't exist, is corrupt, has an unknown version or was written in a different mode.
+ */
+inline bool loadStateFile(const string& path, LogCheckpoint& checkpoint, ConnectionAggregator& aggregator) {
+    BinaryReader reader;
+
+    if (!reader.readFromFile(path) || reader.readBytes(STATE_FILE_MAGIC.size()) != STATE_FILE_MAGIC || reader.readByte() != STATE_FILE_VERSION) {
+        return false;
+    }
+
+    checkpoint.device = reader.readVarInt();
+    checkpoint.inode = reader.readVarInt();
+    checkpoint.offset = reader.readVarInt();
+
+    return aggregator.deserialize(reader) && reader.isAtEnd();
+}
+
+#endif // ENDLESSH_REPORT_INCLUDE_CHECKPOINT_HPP
@@ -0,0 +1,359 @@
+/**
+ * @file connectiontracker.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains the pairing of endlessh's ACCEPT and CLOSE events into individual connections.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_CONNECTIONTRACKER_HPP
+#define ENDLESSH_REPORT_INCLUDE_CONNECTIONTRACKER_HPP
+
+#include "ipaddress.hpp"
+#include "serialization.hpp"
+
+// stl
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+/**
+ * @brief Identifies a single connection to the tarpit.
+ */
+struct ConnectionKey {
+    IpAddress   host{}; //!< The connecting host
+    uint16_t    port{0}; //!< The host's source port
+
+    bool operator==(const ConnectionKey& other) const { return port == other.port && host == other.host; }
+    bool operator<(const ConnectionKey& other) const { return host < other.host || (host == other.host && port < other.port); }
+
+    uint64_t hash() const { return host.hash() ^ (uint64_t(port) * 0x9e3779b97f4a7c15ULL); }
+};
+
+/**
+ * @brief An ACCEPT or CLOSE of a connection, in the order of the tracker's events.
+ */
+struct ConnectionEvent {
+    ConnectionKey   key{}; //!< The connection
+    uint64_t        sequence{0}; //!< When the event was logged, relative to the tracker's accepted connections
+};
+
+/**
+ * @brief Pairs ACCEPT and CLOSE events by host and source port, keeping track of the connections which are still open.
+ *
+ * Open connections are kept in an open-addressing (linear probing) table, which only ever holds the connections
+ * in flight; endlessh itself limits these to a few thousand. Connections whose CLOSE is never logged
+ * (e.g. because endlessh was restarted) would pile up, so the table is bounded by @see MAX_OPEN_CONNECTIONS:
+ * once it's full, the older half of the connections is expired.
+ *
+ * A CLOSE without a matching ACCEPT belongs to a connection accepted before the log started (e.g. before it was rotated).
+ * These orphans are kept, so they can still be paired when an earlier part of the same log is merged in. Like the open
+ * connections, they're bounded by @see MAX_ORPHANED_CLOSES; only the first ones are kept, as those are the ones which
+ * can be paired with the connections left open by an earlier part.
+ *
+ * For the same reason, the (first @see MAX_CLOSED_CONNECTIONS) connections which were both accepted and closed are kept:
+ * if one of them reuses the host and port of a connection left open by an earlier part, that connection's CLOSE was
+ * missed and it's expired on merging, just like @see onAccept does. Within these bounds, merging the trackers of
+ * consecutive parts yields the same connections as tracking the whole log at once.
+ */
+class ConnectionTracker {
+    public: // +++ Constants +++
+        constexpr static size_t MAX_OPEN_CONNECTIONS = 65536; //!< The maximum amount of connections tracked at a time
+        constexpr static size_t MAX_ORPHANED_CLOSES = MAX_OPEN_CONNECTIONS; //!< The maximum amount of orphaned CLOSEs kept
+        constexpr static size_t MAX_CLOSED_CONNECTIONS = MAX_OPEN_CONNECTIONS; //!< The maximum amount of closed connections kept for merging
+
+    public: // +++ Constructor / Destructor +++
+        ConnectionTracker() = default;
+        ConnectionTracker(ConnectionTracker&&) = default;
+        ConnectionTracker& operator=(ConnectionTracker&&) = default;
+        ~ConnectionTracker() = default;
+
+    public: // +++ Events +++
+        /**
+         * @brief Records a newly accepted connection.
+         *
+         * If a connection with the same host and port is still open, its CLOSE was missed; it's expired.
+         */
+        void onAccept(const ConnectionKey& key) {
+            if (m_size + 1 > MAX_OPEN_CONNECTIONS) { expireOldest(); }
+            if ((m_size + 1) * 2 > m_slots.size()) { grow(); }
+
+            auto& slot = findSlot(key);
+
+            if (slot.isUsed) {
+                m_expiredConnections++;
+            } else {
+                slot.isUsed = true;
+                slot.key = key;
+                m_size++;
+            }
+
+            slot.sequence = m_nextSequence++;
+        }
+
+        /**
+         * @brief Records a closed connection.
+         *
+         * @return true If the connection was paired with its ACCEPT.
+         * @return false If its ACCEPT wasn't seen; the CLOSE is kept as an orphan, unless MAX_ORPHANED_CLOSES are kept already.
+         */
+        bool onClose(const ConnectionKey& key) {
+            if (!m_slots.empty()) {
+                auto& slot = findSlot(key);
+
+                if (slot.isUsed) {
+                    addClosedConnection(key, slot.sequence);
+                    erase(slot);
+                    return true;
+                }
+            }
+
+            addOrphanedClose(key);
+            return false;
+        }
+
+        /**
+         * @brief Merges the connections of a later part of the same log into this tracker.
+         *
+         * The other tracker's events are replayed in the order they were logged: its orphaned CLOSEs are paired with the
+         * connections still open here, its closed connections expire the ones open here with the same host and port, and
+         * its open connections are added.
+         *
+         * @param other The tracker of the part of the log following the one tracked here.
+         */
+        void merge(const ConnectionTracker& other) {
+            enum class Kind { OrphanedClose, ClosedConnection, OpenConnection };
+            struct Replay {
+                const ConnectionKey*    key; //!< The connection
+                uint64_t                sequence; //!< When the event was logged in the other tracker
+                Kind                    kind; //!< What to replay
+            };
+
+            vector<Replay> replays;
+            replays.reserve(other.m_orphanedCloses.size() + other.m_closedConnections.size() + other.m_size);
+
+            for (const auto& orphan : other.m_orphanedCloses) { replays.push_back({ &orphan.key, orphan.sequence, Kind::OrphanedClose }); }
+            for (const auto& closed : other.m_closedConnections) { replays.push_back({ &closed.key, closed.sequence, Kind::ClosedConnection }); }
+            for (const auto& slot : other.m_slots) {
+                if (slot.isUsed) { replays.push_back({ &slot.key, slot.sequence, Kind::OpenConnection }); }
+            }
+
+            // An orphaned CLOSE was logged before the connection accepted with the same sequence number
+            std::stable_sort(replays.begin(), replays.end(), [](const Replay& a, const Replay& b) {
+                return a.sequence < b.sequence || (a.sequence == b.sequence && a.kind == Kind::OrphanedClose && b.kind != Kind::OrphanedClose);
+            });
+
+            for (const auto& replay : replays) {
+                switch (replay.kind) {
+                    case Kind::OrphanedClose: onClose(*replay.key); break;
+                    case Kind::ClosedConnection: reopenAndClose(*replay.key); break;
+                    case Kind::OpenConnection: onAccept(*replay.key); break;
+                }
+            }
+
+            m_expiredConnections += other.m_expiredConnections;
+        }
+
+    public: // +++ Serialization +++
+        void serialize(BinaryWriter& writer) const {
+            writer.writeVarInt(m_expiredConnections);
+
+            writer.writeVarInt(m_orphanedCloses.size());
+            for (const auto& orphan : m_orphanedCloses) { writeKey(writer, orphan.key); }
+
+            // Written oldest first, so the order is restored by simply replaying them
+            writer.writeVarInt(m_size);
+            forEachOpenConnection([&writer](const ConnectionKey& key) { writeKey(writer, key); });
+        }
+
+        /**
+         * @brief Deserializes connections written by @see serialize and adds them to this tracker.
+         *
+         * Snapshots may have been taken on other tarpits, so unlike @see merge, the orphaned CLOSEs read are kept as
+         * they are instead of being paired with the connections open here.
+         *
+         * @return true If the connections were read successfully.
+         * @return false Otherwise.
+         */
+        bool deserialize(BinaryReader& reader) {
+            ConnectionTracker other;
+            other.m_expiredConnections = reader.readVarInt();
+
+            const auto orphanCount = reader.readVarInt();
+            for (uint64_t i = 0; i < orphanCount && reader.isGood(); i++) {
+                other.addOrphanedClose(readKey(reader));
+            }
+
+            const auto openCount = reader.readVarInt();
+            for (uint64_t i = 0; i < openCount && reader.isGood(); i++) {
+                other.onAccept(readKey(reader));
+            }
+
+            if (!reader.isGood()) { return false; }
+
+            for (const auto& orphan : other.m_orphanedCloses) { addOrphanedClose(orphan.key); }
+            other.forEachOpenConnection([this](const ConnectionKey& key) { onAccept(key); });
+            m_expiredConnections += other.m_expiredConnections;
+
+            return true;
+        }
+
+    public: // +++ Results +++
+        size_t getOpenConnections() const { return m_size; } //!< The amount of connections which are still open
+        const vector<ConnectionEvent>& getOrphanedCloses() const { return m_orphanedCloses; } //!< The (first MAX_ORPHANED_CLOSES) CLOSEs whose ACCEPT wasn't seen
+
+        /**
+         * @brief Calls the given function for each open connection, oldest first.
+         */
+        template<typename Function>
+        void forEachOpenConnection(Function&& function) const {
+            vector<const Slot*> openSlots;
+            openSlots.reserve(m_size);
+
+            for (const auto& slot : m_slots) {
+                if (slot.isUsed) { openSlots.push_back(&slot); }
+            }
+
+            std::sort(openSlots.begin(), openSlots.end(), [](const Slot* a, const Slot* b) { return a->sequence < b->sequence; });
+            for (const auto* slot : openSlots) { function(slot->key); }
+        }
+
+    private: // +++ Implementation +++
+        constexpr static size_t INITIAL_TABLE_SIZE = 64; //!< The initial amount of slots; must be a power of two
+
+        /**
+         * @brief A slot in the table.
+         */
+        struct Slot {
+            ConnectionKey   key{}; //!< The connection
+            uint64_t        sequence{0}; //!< When the connection was accepted, relative to the others
+            bool            isUsed{false}; //!< Whether the slot holds a connection
+        };
+
+        void addOrphanedClose(const ConnectionKey& key) {
+            if (m_orphanedCloses.size() < MAX_ORPHANED_CLOSES) { m_orphanedCloses.push_back({ key, m_nextSequence }); }
+        }
+
+        void addClosedConnection(const ConnectionKey& key, const uint64_t sequence) {
+            if (m_closedConnections.size() < MAX_CLOSED_CONNECTIONS) { m_closedConnections.push_back({ key, sequence }); }
+        }
+
+        /**
+         * @brief Replays a connection accepted and closed in a later part: a connection still open with the same host and port is expired.
+         */
+        void reopenAndClose(const ConnectionKey& key) {
+            if (!m_slots.empty()) {
+                auto& slot = findSlot(key);
+
+                if (slot.isUsed) {
+                    erase(slot);
+                    m_expiredConnections++;
+                }
+            }
+
+            addClosedConnection(key, m_nextSequence++);
+        }
+
+        static void writeKey(BinaryWriter& writer, const ConnectionKey& key) {
+            writer.writeFixed64(key.host.high);
+            writer.writeFixed64(key.host.low);
+            writer.writeVarInt(key.port);
+        }
+
+        static ConnectionKey readKey(BinaryReader& reader) {
+            ConnectionKey key;
+            key.host.high = reader.readFixed64();
+            key.host.low = reader.readFixed64();
+            key.port = static_cast<uint16_t>(reader.readVarInt());
+
+            return key;
+        }
+
+        /**
+         * @brief Finds the slot holding the given connection, or the empty slot it would be inserted into.
+         */
+        Slot& findSlot(const ConnectionKey& key) {
+            const auto mask = m_slots.size() - 1;
+
+            for (auto index = key.hash() & mask;; index = (index + 1) & mask) {
+                auto& slot = m_slots[index];
+                if (!slot.isUsed || slot.key == key) { return slot; }
+            }
+        }
+
+        /**
+         * @brief Removes a connection, shifting the following entries back so no tombstones are needed.
+         */
+        void erase(Slot& slot) {
+            const auto mask = m_slots.size() - 1;
+            auto hole = static_cast<size_t>(&slot - m_slots.data());
+
+            for (auto index = (hole + 1) & mask; m_slots[index].isUsed; index = (index + 1) & mask) {
+                const auto home = m_slots[index].key.hash() & mask;
+
+                // Move the entry into the hole unless its home slot lies cyclically in (hole, index]
+                if (((index - home) & mask) >= ((index - hole) & mask)) {
+                    m_slots[hole] = m_slots[index];
+                    hole = index;
+                }
+            }
+
+            m_slots[hole] = Slot{};
+            m_size--;
+        }
+
+        /**
+         * @brief Doubles the size of the table and re-inserts all connections.
+         */
+        void grow() { rebuild(m_slots.empty() ? INITIAL_TABLE_SIZE : m_slots.size() * 2, 0); }
+
+        /**
+         * @brief Expires the older half of the open connections, whose CLOSEs have most likely been lost.
+         */
+        void expireOldest() {
+            vector<uint64_t> sequences;
+            sequences.reserve(m_size);
+
+            for (const auto& slot : m_slots) {
+                if (slot.isUsed) { sequences.push_back(slot.sequence); }
+            }
+
+            const auto median = sequences.begin() + sequences.size() / 2;
+            std::nth_element(sequences.begin(), median, sequences.end());
+
+            const auto sizeBefore = m_size;
+            rebuild(m_slots.size(), *median);
+            m_expiredConnections += sizeBefore - m_size;
+        }
+
+        /**
+         * @brief Re-inserts all connections accepted at or after minSequence into a table of the given size.
+         */
+        void rebuild(const size_t tableSize, const uint64_t minSequence) {
+            vector<Slot> oldSlots(tableSize);
+            oldSlots.swap(m_slots);
+            m_size = 0;
+
+            for (const auto& slot : oldSlots) {
+                if (!slot.isUsed || slot.sequence < minSequence) { continue; }
+
+                auto& newSlot = findSlot(slot.key);
+                newSlot = slot;
+                m_size++;
+            }
+        }
+
+    private: // +++ Members +++
+        vector<Slot>            m_slots; //!< The open-addressing table of open connections
+        size_t                  m_size{0}; //!< The amount of open connections
+        uint64_t                m_nextSequence{0}; //!< The sequence number of the next accepted connection
+        uint64_t                m_expiredConnections{0}; //!< The amount of connections whose CLOSE was never seen
+        vector<ConnectionEvent> m_orphanedCloses; //!< The (first MAX_ORPHANED_CLOSES) CLOSEs whose ACCEPT wasn't seen
+        vector<ConnectionEvent> m_closedConnections; //!< The (first MAX_CLOSED_CONNECTIONS) connections accepted and closed, by the sequence of their ACCEPT
+};
+
+#endif // ENDLESSH_REPORT_INCLUDE_CONNECTIONTRACKER_HPP
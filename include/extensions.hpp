@@ -34,7 +34,7 @@ using std::string;
 using std::vector;
 
 /**
- * @brief Splits a given string by the passed delimiters in to a vector.
+ * @brief Splits a given string by the passed delimiters into a vector.
  *
  * @param str string& The string to split.
  * @param delimiters string& A string containing the delimiters to split by (chars).
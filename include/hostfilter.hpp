@@ -0,0 +1,259 @@
+/**
+ * @file hostfilter.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains the filtering of hosts by the network prefixes (CIDR ranges) they lie in.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_HOSTFILTER_HPP
+#define ENDLESSH_REPORT_INCLUDE_HOSTFILTER_HPP
+
+#include "ipaddress.hpp"
+#include "prefixtrie.hpp"
+
+// stl
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using std::pair;
+using std::string;
+using std::string_view;
+using std::vector;
+
+/**
+ * @brief A set of network prefixes, compiled into sorted, non-overlapping address ranges.
+ *
+ * IPv4 ranges are kept as pairs of 32-bit addresses, so the common case of looking up an IPv4 host is a binary search
+ * over eight bytes per range. Ranges added before @see compile may overlap; compiling merges them.
+ */
+class AddressRangeSet {
+    public: // +++ Modification +++
+        void add(const IpPrefix& prefix) {
+            const auto last = getLastAddress(prefix);
+
+            if (prefix.isV4()) {
+                m_v4Ranges.emplace_back(static_cast<uint32_t>(prefix.address.low), static_cast<uint32_t>(last.low));
+                return;
+            }
+
+            m_v6Ranges.emplace_back(prefix.address, last);
+
+            // A prefix spanning the whole IPv4 space (e.g. ::/0) contains every IPv4 host
+            if (prefix.length <= 96 && IpPrefix::of(getV4MappedSpace(), prefix.length).address == prefix.address) {
+                m_v4Ranges.emplace_back(0, UINT32_MAX);
+            }
+        }
+
+        /**
+         * @brief Sorts and merges the ranges; must be called after adding prefixes and before looking up hosts.
+         */
+        void compile() {
+            compileRanges(m_v4Ranges, [](const uint32_t end) { return end == UINT32_MAX ? end : end + 1; });
+            compileRanges(m_v6Ranges, [](const IpAddress& end) {
+                auto next = end;
+                if (++next.low == 0) { next.high++; }
+
+                return end.high == UINT64_MAX && end.low == UINT64_MAX ? end : next;
+            });
+        }
+
+    public: // +++ Results +++
+        bool isEmpty() const { return m_v4Ranges.empty() && m_v6Ranges.empty(); }
+
+        bool contains(const IpAddress& host) const {
+            if (host.isV4()) { return containsIn(m_v4Ranges, static_cast<uint32_t>(host.low)); }
+
+            return containsIn(m_v6Ranges, host);
+        }
+
+    private: // +++ Implementation +++
+        static IpAddress getV4MappedSpace() {
+            IpAddress address;
+            address.low = uint64_t(0xffff) << 32;
+
+            return address;
+        }
+
+        static IpAddress getLastAddress(const IpPrefix& prefix) {
+            auto last = prefix.address;
+            if (prefix.length < 64) { last.high |= UINT64_MAX >> prefix.length; }
+            if (prefix.length <= 64) { last.low = UINT64_MAX; }
+            else if (prefix.length < 128) { last.low |= UINT64_MAX >> (prefix.length - 64); }
+
+            return last;
+        }
+
+        /**
+         * @brief Sorts ranges by their start and merges overlapping and adjacent ones.
+         *
+         * @param getNext Gets the address following the end of a range (saturating).
+         */
+        template<typename Address, typename NextFunction>
+        static void compileRanges(vector<pair<Address, Address>>& ranges, NextFunction&& getNext) {
+            std::sort(ranges.begin(), ranges.end());
+
+            size_t mergedCount = 0;
+            for (const auto& range : ranges) {
+                if (mergedCount > 0 && !(getNext(ranges[mergedCount - 1].second) < range.first)) {
+                    ranges[mergedCount - 1].second = std::max(ranges[mergedCount - 1].second, range.second);
+                } else {
+                    ranges[mergedCount++] = range;
+                }
+            }
+
+            ranges.resize(mergedCount);
+            ranges.shrink_to_fit();
+        }
+
+        template<typename Address>
+        static bool containsIn(const vector<pair<Address, Address>>& ranges, const Address& host) {
+            // The last range starting at or before the host is the only one which can contain it
+            const auto next = std::upper_bound(ranges.begin(), ranges.end(), host, [](const Address& address, const auto& range) {
+                return address < range.first;
+            });
+
+            return next != ranges.begin() && !(std::prev(next)->second < host);
+        }
+
+    private: // +++ Members +++
+        vector<pair<uint32_t, uint32_t>>    m_v4Ranges; //!< The first and last IPv4 address of each range
+        vector<pair<IpAddress, IpAddress>>  m_v6Ranges; //!< The first and last address of each (non-IPv4) range
+};
+
+/**
+ * @brief Decides which hosts to report, by the network prefixes they lie in.
+ *
+ * A host is reported if it lies within any of the included prefixes (or none were given) and within none of the
+ * excluded ones; exclusions take precedence.
+ */
+class HostFilter {
+    public: // +++ Parsing +++
+        /**
+         * @brief Parses a prefix in CIDR notation, e.g. 203.0.113.0/24 or 2001:db8::/32.
+         *
+         * An address without a length is a prefix of a single host. Bits past the length are ignored.
+         *
+         * @return true If the prefix was parsed successfully.
+         * @return false Otherwise.
+         */
+        static bool parseCidr(const string_view text, IpPrefix& prefix) {
+            const auto separator = text.find('/');
+            IpAddress address;
+
+            if (!IpAddress::parse(text.substr(0, separator), address)) { return false; }
+
+            const auto maxLength = address.isV4() && text.find(':') == string_view::npos ? 32u : 128u;
+            auto length = maxLength;
+
+            if (separator != string_view::npos) {
+                const auto lengthText = string(text.substr(separator + 1));
+                char* end = nullptr;
+                const auto parsedLength = std::strtoul(lengthText.c_str(), &end, 10);
+
+                if (lengthText.empty() || *end != '\0' || parsedLength > maxLength) { return false; }
+                length = static_cast<uint32_t>(parsedLength);
+            }
+
+            prefix = IpPrefix::of(address, maxLength == 32 ? 96 + length : length);
+            return true;
+        }
+
+    public: // +++ Modification +++
+        /**
+         * @brief Adds a comma-separated list of prefixes in CIDR notation.
+         *
+         * @param list The list of prefixes.
+         * @param isIncluded Whether the hosts within the prefixes are to be included or excluded.
+         *
+         * @return true If all prefixes were parsed successfully.
+         * @return false Otherwise.
+         */
+        bool addList(const string_view list, const bool isIncluded) {
+            size_t start = 0;
+
+            while (start <= list.size()) {
+                const auto end = std::min(list.find(',', start), list.size());
+                IpPrefix prefix;
+
+                if (!parseCidr(list.substr(start, end - start), prefix)) { return false; }
+
+                (isIncluded ? m_included : m_excluded).add(prefix);
+                start = end + 1;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Adds the prefixes listed in a file: one per line, ignoring empty lines and comments (#).
+         *
+         * @param path The path to the file.
+         * @param isIncluded Whether the hosts within the prefixes are to be included or excluded.
+         * @param errorMessage Will contain a description of the error, if any.
+         *
+         * @return true If the file was read and all prefixes were parsed successfully.
+         * @return false Otherwise.
+         */
+        bool addFile(const string& path, const bool isIncluded, string& errorMessage) {
+            std::ifstream fileStream(path);
+            if (!fileStream) {
+                errorMessage = "Failed to open " + path;
+                return false;
+            }
+
+            string line;
+            for (size_t lineNumber = 1; std::getline(fileStream, line); lineNumber++) {
+                string_view prefixText(line);
+                prefixText = prefixText.substr(0, prefixText.find('#'));
+
+                const auto start = prefixText.find_first_not_of(" \t\r");
+                if (start == string_view::npos) { continue; }
+                prefixText = prefixText.substr(start, prefixText.find_last_not_of(" \t\r") + 1 - start);
+
+                IpPrefix prefix;
+                if (!parseCidr(prefixText, prefix)) {
+                    errorMessage = path + ":" + std::to_string(lineNumber) + ": invalid prefix " + string(prefixText);
+                    return false;
+                }
+
+                (isIncluded ? m_included : m_excluded).add(prefix);
+            }
+
+            if (fileStream.bad()) {
+                errorMessage = "Failed to read " + path;
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Compiles the prefixes for lookup; must be called after adding them and before looking up hosts.
+         */
+        void compile() {
+            m_included.compile();
+            m_excluded.compile();
+        }
+
+    public: // +++ Results +++
+        bool isActive() const { return !m_included.isEmpty() || !m_excluded.isEmpty(); }
+
+        bool allows(const IpAddress& host) const {
+            return (m_included.isEmpty() || m_included.contains(host)) && !m_excluded.contains(host);
+        }
+
+    private: // +++ Members +++
+        AddressRangeSet m_included; //!< The prefixes to include; empty to include all hosts
+        AddressRangeSet m_excluded; //!< The prefixes to exclude
+};
+
+#endif // ENDLESSH_REPORT_INCLUDE_HOSTFILTER_HPP
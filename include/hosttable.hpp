@@ -0,0 +1,175 @@
+/**
+ * @file hosttable.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains the per-host connection details and a hash-indexed table to store them in.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_HOSTTABLE_HPP
+#define ENDLESSH_REPORT_INCLUDE_HOSTTABLE_HPP
+
+#include "ipaddress.hpp"
+#include "portset.hpp"
+
+// stl
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+using std::unique_ptr;
+using std::vector;
+
+/**
+ * @brief Contains information about a given connection.
+ */
+struct ConnectionDetails {
+    size_t              acceptedConnections; //!< The total amount of accepted connections
+    size_t              closedConnections; //!< The total amount of closed connections
+
+    PortSet             usedPorts; //!< The distinct source ports used.
+
+    uint64_t            totalMillisecondsWasted; //!< The total milliseconds of bot time wasted
+
+    size_t              totalBytesSent; //!< The total amount of bytes sent to the bots
+
+    IpAddress           host; //!< The host trying to attack the system.
+
+    /**
+     * @param portMemory The memory resource to allocate the used ports from.
+     */
+    explicit ConnectionDetails(std::pmr::memory_resource* portMemory = std::pmr::get_default_resource()): acceptedConnections(0), closedConnections(0),
+    usedPorts(portMemory), totalMillisecondsWasted(0), totalBytesSent(0), host({}) {}
+    ConnectionDetails(ConnectionDetails&&) = default;
+    ConnectionDetails& operator=(ConnectionDetails&&) = default;
+    ~ConnectionDetails() = default;
+
+    /**
+     * @brief Gets the total seconds of bot time wasted.
+     */
+    double getSecondsWasted() const { return totalMillisecondsWasted / 1000.0; }
+};
+
+/**
+ * @brief A table of @see ConnectionDetails, indexed by host.
+ *
+ * The records are kept in a contiguous array in the order the hosts were first seen.
+ * An open-addressing (linear probing) index maps each host to its slot in that array,
+ * so looking up or inserting a host is O(1) amortised.
+ *
+ * The ports used by the hosts are allocated from a pool owned by the table. The pool takes memory from the heap in
+ * ever larger chunks and recycles the blocks of port sets which have grown, so once the table has warmed up, adding
+ * ports doesn't allocate at all.
+ */
+class HostTable {
+    public: // +++ Types +++
+        using const_iterator = vector<ConnectionDetails>::const_iterator;
+
+    public: // +++ Constructor / Destructor +++
+        HostTable(): m_portMemory(std::make_unique<std::pmr::unsynchronized_pool_resource>(getPortPoolOptions())) {}
+        HostTable(HostTable&&) = default;
+        ~HostTable() = default;
+
+        /**
+         * @brief Takes over another table. The records are replaced before the pool they were allocated from is.
+         */
+        HostTable& operator=(HostTable&& other) noexcept {
+            m_records = std::move(other.m_records);
+            m_index = std::move(other.m_index);
+            m_portMemory = std::move(other.m_portMemory);
+
+            return *this;
+        }
+
+    public: // +++ Lookup +++
+        /**
+         * @brief Gets the record for the given host, inserting an empty one if the host is unknown.
+         *
+         * @param host The host to look up.
+         *
+         * @return ConnectionDetails& A reference to the host's record. Only valid until the next insertion.
+         */
+        ConnectionDetails& findOrInsert(const IpAddress& host) {
+            if ((m_records.size() + 1) * 2 > m_index.size()) {
+                grow();
+            }
+
+            const auto hash = hashHost(host);
+            const auto mask = m_index.size() - 1;
+
+            for (auto slot = hash & mask;; slot = (slot + 1) & mask) {
+                auto& entry = m_index[slot];
+
+                if (entry.recordIndex == EMPTY_SLOT) {
+                    entry.hash = hash;
+                    entry.recordIndex = static_cast<uint32_t>(m_records.size());
+
+                    auto& record = m_records.emplace_back(m_portMemory.get());
+                    record.host = host;
+                    return record;
+                } else if (entry.hash == hash && m_records[entry.recordIndex].host == host) {
+                    return m_records[entry.recordIndex];
+                }
+            }
+        }
+
+    public: // +++ Iteration +++
+        const_iterator  begin() const { return m_records.cbegin(); }
+        const_iterator  end() const { return m_records.cend(); }
+        size_t          size() const { return m_records.size(); }
+        bool            empty() const { return m_records.empty(); }
+
+    private: // +++ Implementation +++
+        constexpr static uint32_t EMPTY_SLOT = UINT32_MAX; //!< Marks an unused slot in the index
+        constexpr static size_t INITIAL_INDEX_SIZE = 64; //!< The initial amount of slots in the index; must be a power of two
+
+        /**
+         * @brief An entry in the index. The hash is kept alongside the record index so probing rarely touches the records.
+         */
+        struct IndexEntry {
+            uint32_t hash{0}; //!< The (truncated) hash of the host
+            uint32_t recordIndex{EMPTY_SLOT}; //!< The index of the record in m_records
+        };
+
+        static uint32_t hashHost(const IpAddress& host) { return static_cast<uint32_t>(host.hash()); }
+
+        /**
+         * @brief Pools blocks of up to a full list of sorted ports; a port set is promoted to a bitmap beyond that.
+         */
+        static std::pmr::pool_options getPortPoolOptions() {
+            std::pmr::pool_options options;
+            options.largest_required_pool_block = PortSet::MAX_SORTED_PORTS * sizeof(uint16_t);
+
+            return options;
+        }
+
+        /**
+         * @brief Doubles the size of the index and re-inserts all entries.
+         */
+        void grow() {
+            vector<IndexEntry> newIndex(m_index.empty() ? INITIAL_INDEX_SIZE : m_index.size() * 2);
+            const auto mask = newIndex.size() - 1;
+
+            for (const auto& entry : m_index) {
+                if (entry.recordIndex == EMPTY_SLOT) { continue; }
+
+                auto slot = entry.hash & mask;
+                while (newIndex[slot].recordIndex != EMPTY_SLOT) { slot = (slot + 1) & mask; }
+                newIndex[slot] = entry;
+            }
+
+            m_index.swap(newIndex);
+        }
+
+    private: // +++ Members +++
+        // The pool is declared first, so it outlives the records allocating from it
+        unique_ptr<std::pmr::unsynchronized_pool_resource> m_portMemory; //!< The pool the used ports of all records are allocated from
+        vector<ConnectionDetails>   m_records; //!< The records, in the order they were first seen
+        vector<IndexEntry>          m_index; //!< The open-addressing index into m_records
+};
+
+#endif // ENDLESSH_REPORT_INCLUDE_HOSTTABLE_HPP
@@ -0,0 +1,143 @@
+/**
+ * @file ipaddress.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains a compact, binary representation of IPv4 and IPv6 addresses.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_IPADDRESS_HPP
+#define ENDLESSH_REPORT_INCLUDE_IPADDRESS_HPP
+
+// stl
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string_view>
+
+// libc
+#include <arpa/inet.h>
+
+using std::string_view;
+
+/**
+ * @brief An IP address stored as a 128-bit integer.
+ *
+ * IPv4 addresses are stored as IPv4-mapped IPv6 addresses (::ffff:a.b.c.d), so both
+ * families share one fixed-size key. The address is kept as two integers in host byte order,
+ * which means comparisons follow numeric address order and hashing never touches text.
+ */
+struct IpAddress {
+    uint64_t    high{0}; //!< The upper 64 bits of the address
+    uint64_t    low{0}; //!< The lower 64 bits of the address
+
+    /**
+     * @brief Parses an IPv4 or IPv6 address in text form.
+     *
+     * @param text The address, e.g. "::ffff:1.2.3.4", "1.2.3.4" or "2001:db8::1".
+     * @param address Will contain the parsed address.
+     *
+     * @return true If the address was parsed successfully.
+     * @return false Otherwise.
+     */
+    static bool parse(const string_view text, IpAddress& address) {
+        // inet_pton requires a null-terminated string; copy to the stack
+        char buffer[INET6_ADDRSTRLEN + 1];
+        if (text.empty() || text.size() >= sizeof(buffer)) { return false; }
+
+        memcpy(buffer, text.data(), text.size());
+        buffer[text.size()] = '\0';
+
+        uint8_t bytes[16] = { 0 };
+        if (text.find(':') == string_view::npos) {
+            if (inet_pton(AF_INET, buffer, bytes + 12) != 1) { return false; }
+            bytes[10] = bytes[11] = 0xff;
+        } else if (inet_pton(AF_INET6, buffer, bytes) != 1) {
+            return false;
+        }
+
+        address = fromBytes(bytes);
+        return true;
+    }
+
+    /**
+     * @brief Creates an address from 16 bytes in network byte order.
+     */
+    static IpAddress fromBytes(const uint8_t* bytes) {
+        IpAddress address;
+
+        for (uint32_t i = 0; i < 8; i++) {
+            address.high = (address.high << 8) | bytes[i];
+            address.low = (address.low << 8) | bytes[i + 8];
+        }
+
+        return address;
+    }
+
+    /**
+     * @brief Writes the address to 16 bytes in network byte order.
+     */
+    void toBytes(uint8_t* bytes) const {
+        for (uint32_t i = 0; i < 8; i++) {
+            bytes[7 - i] = static_cast<uint8_t>(high >> (i * 8));
+            bytes[15 - i] = static_cast<uint8_t>(low >> (i * 8));
+        }
+    }
+
+    /**
+     * @brief Gets a value indicating whether this is an IPv4(-mapped) address.
+     */
+    bool isV4() const { return high == 0 && (low >> 32) == 0xffff; }
+
+    /**
+     * @brief Converts the address to text. IPv4-mapped addresses are printed as plain IPv4 addresses.
+     *
+     * @param buffer The buffer to write the text to; must hold at least INET6_ADDRSTRLEN characters.
+     *
+     * @return string_view The textual representation of the address, backed by buffer.
+     */
+    string_view toChars(char* buffer) const {
+        uint8_t bytes[16];
+        toBytes(bytes);
+
+        if (isV4()) {
+            inet_ntop(AF_INET, bytes + 12, buffer, INET6_ADDRSTRLEN);
+        } else {
+            inet_ntop(AF_INET6, bytes, buffer, INET6_ADDRSTRLEN);
+        }
+
+        return string_view(buffer);
+    }
+
+    /**
+     * @brief Gets a well-mixed hash of the address.
+     */
+    uint64_t hash() const {
+        // 64-bit finaliser from MurmurHash3, applied to both halves
+        auto mix = [](uint64_t x) {
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdULL;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ULL;
+            x ^= x >> 33;
+            return x;
+        };
+
+        return mix(high ^ mix(low));
+    }
+
+    bool operator==(const IpAddress& other) const { return high == other.high && low == other.low; }
+    bool operator!=(const IpAddress& other) const { return !(*this == other); }
+    bool operator<(const IpAddress& other) const { return high != other.high ? high < other.high : low < other.low; }
+};
+
+namespace std {
+    template<>
+    struct hash<IpAddress> {
+        size_t operator()(const IpAddress& address) const { return static_cast<size_t>(address.hash()); }
+    };
+}
+
+#endif // ENDLESSH_REPORT_INCLUDE_IPADDRESS_HPP
@@ -0,0 +1,144 @@
+/**
+ * @file ipstats.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains the ranking and rendering of the statistics per IP, shared by the report and its benchmarks.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_IPSTATS_HPP
+#define ENDLESSH_REPORT_INCLUDE_IPSTATS_HPP
+
+#include "aggregator.hpp"
+#include "extensions.hpp"
+#include "hosttable.hpp"
+#include "ranking.hpp"
+#include "reportwriter.hpp"
+
+// stl
+#include <cstdint>
+#include <vector>
+
+// libc
+#include <arpa/inet.h>
+
+using std::vector;
+
+/**
+ * @brief Selects the basic IP stats to report: all of them in the table's order, or the top hosts by the given field.
+ * 
+ * @param connectionList The connection list
+ * @param rankingField The statistic to rank the hosts by.
+ * @param topCount The maximum amount of hosts to select when ranking.
+ * 
+ * @return vector<const ConnectionAggregator::ConnectionMap::value_type*> The entries to report, in the order to report them in.
+ */
+inline vector<const ConnectionAggregator::ConnectionMap::value_type*> rankHosts(const ConnectionAggregator::ConnectionMap& connectionList, const RankingField rankingField, const size_t topCount) {
+    using Entry = ConnectionAggregator::ConnectionMap::value_type;
+
+    if (rankingField == RankingField::None) {
+        vector<const Entry*> entries;
+        entries.reserve(connectionList.size());
+        for (const auto& connection : connectionList) { entries.push_back(&connection); }
+
+        return entries;
+    }
+
+    // Only accepted and closed connections are counted outside of detailed mode (see parseArgs)
+    const auto isRankedByClosed = rankingField == RankingField::Closed;
+    return selectTopEntries(connectionList, topCount, [isRankedByClosed](const Entry& connection) -> uint64_t {
+        return isRankedByClosed ? connection.second.second : connection.second.first;
+    });
+}
+
+/**
+ * @brief Selects the detailed IP stats to report: all of them in the table's order, or the top hosts by the given field.
+ * 
+ * @param connectionList The list of connections.
+ * @param rankingField The statistic to rank the hosts by.
+ * @param topCount The maximum amount of hosts to select when ranking.
+ * 
+ * @return vector<const ConnectionDetails*> The entries to report, in the order to report them in.
+ */
+inline vector<const ConnectionDetails*> rankHosts(const HostTable& connectionList, const RankingField rankingField, const size_t topCount) {
+    if (rankingField == RankingField::None) {
+        vector<const ConnectionDetails*> entries;
+        entries.reserve(connectionList.size());
+        for (const auto& connection : connectionList) { entries.push_back(&connection); }
+
+        return entries;
+    }
+
+    return selectTopEntries(connectionList, topCount, [rankingField](const ConnectionDetails& connection) -> uint64_t {
+        switch (rankingField) {
+            case RankingField::Closed: return connection.closedConnections;
+            case RankingField::Ports: return connection.usedPorts.size();
+            case RankingField::TimeWasted: return connection.totalMillisecondsWasted;
+            case RankingField::BytesSent: return connection.totalBytesSent;
+            default: return connection.acceptedConnections;
+        }
+    });
+}
+
+/**
+ * @brief Print the markdown header for the IP statistics table.
+ * 
+ * @param writer The writer to print to
+ * @param detailed Whether the table holds the detailed statistics
+ */
+inline void printIpStatsTableHeader(ReportWriter& writer, const bool detailed) {
+    writer.write("# Statistics per IP").endLine();
+
+    if (!detailed) {
+        writer.write("|          Host          | Accepted | Closed |").endLine()
+              .write("|------------------------|----------|--------|").endLine();
+    } else {
+        writer.write("|          Host          | Accepted | Closed | Distinct Ports | Total Time (s) | Total Bytes |").endLine()
+              .write("|------------------------|----------|--------|----------------|----------------|-------------|").endLine();
+    }
+}
+
+/**
+ * @brief Prints the basic IP statistics table in markdown-format
+ * 
+ * @param writer The writer to print to
+ * @param connectionList The connection list
+ * @param rankingField The statistic to rank the hosts by. @see rankHosts
+ * @param topCount The maximum amount of hosts to print when ranking.
+ */
+inline void printIpStats(ReportWriter& writer, const ConnectionAggregator::ConnectionMap& connectionList, const RankingField rankingField, const size_t topCount) {
+    char hostBuffer[INET6_ADDRSTRLEN];
+
+    for (const auto* connection : rankHosts(connectionList, rankingField, topCount)) {
+        writer.write('|').writeCentred(connection->first.toChars(hostBuffer), 24)
+              .write('|').writeCentred(connection->second.first, 10)
+              .write('|').writeCentred(connection->second.second, 8)
+              .write('|').endLine();
+    }
+}
+
+/**
+ * @brief Prints a markdown-compatible table containing detailed information, such as the total time of the bot wasted and the bytes sent.
+ * 
+ * @param writer The writer to print to
+ * @param connectionList The list of connections.
+ * @param rankingField The statistic to rank the hosts by. @see rankHosts
+ * @param topCount The maximum amount of hosts to print when ranking.
+ */
+inline void printDetailedIpStats(ReportWriter& writer, const HostTable& connectionList, const RankingField rankingField, const size_t topCount) {
+    char hostBuffer[INET6_ADDRSTRLEN];
+
+    for (const auto* connection : rankHosts(connectionList, rankingField, topCount)) {
+        writer.write('|').writeCentred(connection->host.toChars(hostBuffer), 24)
+              .write('|').writeCentred(connection->acceptedConnections, 10)
+              .write('|').writeCentred(connection->closedConnections, 8)
+              .write('|').writeCentred(connection->usedPorts.size(), 16)
+              .write('|').writeCentred(getHumanReadableTime(connection->getSecondsWasted()), 16)
+              .write('|').writeCentred(getHumanReadableBytes(connection->totalBytesSent), 13)
+              .write('|').endLine();
+    }
+}
+
+#endif // ENDLESSH_REPORT_INCLUDE_IPSTATS_HPP
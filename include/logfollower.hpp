@@ -0,0 +1,232 @@
+/**
+ * @file logfollower.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains a log tailer which uses inotify to pick up new lines and follows the log across rotations.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_LOGFOLLOWER_HPP
+#define ENDLESSH_REPORT_INCLUDE_LOGFOLLOWER_HPP
+
+// stl
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// libc
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+/**
+ * @brief Follows a log file as it grows, similar to `tail -F`.
+ *
+ * The directory containing the log is watched with inotify, so the follower wakes up when the log is written to,
+ * and also when it's rotated (renamed, deleted or re-created). After a rotation, the old file is read to its end
+ * before the new one is opened; if the log is truncated, it's read again from the start.
+ * Only complete lines are passed on; an incomplete trailing line is held back until its newline arrives.
+ */
+class LogFollower {
+    public: // +++ Constants +++
+        constexpr static size_t READ_BUFFER_SIZE = 256 * 1024; //!< The size of the read buffer
+
+    public: // +++ Constructor / Destructor +++
+        LogFollower() = default;
+        LogFollower(const LogFollower&) = delete;
+        LogFollower& operator=(const LogFollower&) = delete;
+        ~LogFollower() { close(); }
+
+    public: // +++ Open / Close +++
+        /**
+         * @brief Starts following the log at the given path.
+         *
+         * @param path The path of the log to follow.
+         *
+         * @return true If the log and its directory could be watched.
+         * @return false Otherwise. errno is left untouched for the caller to inspect.
+         */
+        bool open(const string& path) {
+            close();
+
+            m_path = path;
+            const auto separator = path.find_last_of('/');
+            m_fileName = separator == string::npos ? path : path.substr(separator + 1);
+            const auto directory = separator == string::npos ? string(".") : (separator == 0 ? string("/") : path.substr(0, separator));
+
+            if ((m_notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0) { return false; }
+
+            constexpr uint32_t WATCH_MASK = IN_MODIFY | IN_CREATE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE | IN_ATTRIB;
+            if (inotify_add_watch(m_notifyFd, directory.c_str(), WATCH_MASK) < 0) { return false; }
+
+            return reopen();
+        }
+
+        /**
+         * @brief Stops following the log.
+         */
+        void close() {
+            if (m_fd >= 0) { ::close(m_fd); }
+            if (m_notifyFd >= 0) { ::close(m_notifyFd); }
+
+            m_fd = m_notifyFd = -1;
+            m_bytesPending = 0;
+        }
+
+    public: // +++ Reading +++
+        /**
+         * @brief Waits until the log changes, a signal is delivered or the timeout expires.
+         *
+         * @param timeoutMs The maximum time to wait, in milliseconds. Negative values wait indefinitely.
+         * @param signalMask The signal mask to apply while waiting (@see ppoll), or nullptr.
+         *
+         * @return true If the log (or its directory) changed.
+         * @return false On timeout or if interrupted by a signal.
+         */
+        bool waitForChanges(const int64_t timeoutMs, const sigset_t* signalMask) {
+            pollfd pollFd{ m_notifyFd, POLLIN, 0 };
+            timespec timeout{ static_cast<time_t>(timeoutMs / 1000), static_cast<long>((timeoutMs % 1000) * 1000000) };
+
+            if (ppoll(&pollFd, 1, timeoutMs < 0 ? nullptr : &timeout, signalMask) <= 0) { return false; }
+
+            // Drain the events; which file changed doesn't matter, as readNewLines checks for itself
+            bool isRelevant = false;
+            alignas(inotify_event) char eventBuffer[4096];
+            ssize_t bytesRead;
+
+            while ((bytesRead = read(m_notifyFd, eventBuffer, sizeof(eventBuffer))) > 0) {
+                for (ssize_t offset = 0; offset < bytesRead;) {
+                    const auto* event = reinterpret_cast<const inotify_event*>(eventBuffer + offset);
+                    isRelevant |= event->len == 0 || m_fileName == event->name;
+                    offset += sizeof(inotify_event) + event->len;
+                }
+            }
+
+            return isRelevant;
+        }
+
+        /**
+         * @brief Reads all complete lines appended to the log since the last call and passes them to the handler.
+         *
+         * Handles rotation and truncation of the log transparently.
+         *
+         * @tparam LineHandler A callable accepting a string_view.
+         *
+         * @param handler The handler to call for each line.
+         *
+         * @return true If the log was read successfully.
+         * @return false If a read error occurred.
+         */
+        template<typename LineHandler>
+        bool readNewLines(LineHandler&& handler) {
+            if (m_fd >= 0) {
+                struct stat fileInfo{};
+                if (fstat(m_fd, &fileInfo) == 0 && static_cast<uint64_t>(fileInfo.st_size) < m_offset) {
+                    // Truncated (e.g. copytruncate); start over
+                    lseek(m_fd, 0, SEEK_SET);
+                    m_offset = 0;
+                    m_bytesPending = 0;
+                }
+
+                if (!drain(handler)) { return false; }
+            }
+
+            struct stat pathInfo{};
+            const auto pathExists = stat(m_path.c_str(), &pathInfo) == 0;
+
+            if (pathExists && (m_fd < 0 || static_cast<uint64_t>(pathInfo.st_ino) != m_inode || static_cast<uint64_t>(pathInfo.st_dev) != m_device)) {
+                // Rotated: the old file has been read to its end above, so switch over to the new one
+                if (m_bytesPending > 0) {
+                    handler(string_view(m_buffer.data(), m_bytesPending));
+                    m_bytesPending = 0;
+                }
+
+                if (!reopen()) { return false; }
+                return drain(handler);
+            }
+
+            return true;
+        }
+
+        int32_t getNotifyFd() const { return m_notifyFd; }
+
+    private: // +++ Implementation +++
+        bool reopen() {
+            if (m_fd >= 0) { ::close(m_fd); }
+
+            m_offset = 0;
+            m_bytesPending = 0;
+
+            if ((m_fd = ::open(m_path.c_str(), O_RDONLY | O_CLOEXEC)) < 0) {
+                // The log may not have been re-created yet; it'll be picked up on the next change
+                return errno == ENOENT;
+            }
+
+            struct stat fileInfo{};
+            if (fstat(m_fd, &fileInfo) != 0) { return false; }
+
+            m_device = static_cast<uint64_t>(fileInfo.st_dev);
+            m_inode = static_cast<uint64_t>(fileInfo.st_ino);
+
+            return true;
+        }
+
+        template<typename LineHandler>
+        bool drain(LineHandler& handler) {
+            if (m_buffer.size() < READ_BUFFER_SIZE) { m_buffer.resize(READ_BUFFER_SIZE); }
+
+            while (true) {
+                if (m_bytesPending == m_buffer.size()) { m_buffer.resize(m_buffer.size() * 2); }
+
+                const auto bytesRead = ::read(m_fd, m_buffer.data() + m_bytesPending, m_buffer.size() - m_bytesPending);
+                if (bytesRead < 0 && errno == EINTR) { continue; }
+                if (bytesRead < 0) { return false; }
+                if (bytesRead == 0) { return true; }
+
+                m_offset += static_cast<uint64_t>(bytesRead);
+                m_bytesPending += static_cast<size_t>(bytesRead);
+
+                const char* lineStart = m_buffer.data();
+                const char* const end = m_buffer.data() + m_bytesPending;
+                const char* lineEnd;
+
+                while ((lineEnd = static_cast<const char*>(memchr(lineStart, '\n', end - lineStart))) != nullptr) {
+                    handler(string_view(lineStart, lineEnd - lineStart));
+                    lineStart = lineEnd + 1;
+                }
+
+                m_bytesPending = end - lineStart;
+                if (m_bytesPending > 0 && lineStart != m_buffer.data()) {
+                    memmove(m_buffer.data(), lineStart, m_bytesPending);
+                }
+            }
+        }
+
+    private: // +++ Members +++
+        string          m_path; //!< The path of the log
+        string          m_fileName; //!< The file name of the log, to filter inotify events by
+
+        int32_t         m_fd{-1}; //!< The currently open log
+        int32_t         m_notifyFd{-1}; //!< The inotify instance
+
+        uint64_t        m_device{0}; //!< The device of the currently open log
+        uint64_t        m_inode{0}; //!< The inode of the currently open log
+        uint64_t        m_offset{0}; //!< The amount of bytes read from the currently open log
+
+        vector<char>    m_buffer; //!< The read buffer
+        size_t          m_bytesPending{0}; //!< The size of the incomplete line at the start of m_buffer
+};
+
+#endif // ENDLESSH_REPORT_INCLUDE_LOGFOLLOWER_HPP
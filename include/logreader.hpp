@@ -0,0 +1,533 @@
+/**
+ * @file logreader.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains a zero-copy log reader which hands out lines as string_views.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_LOGREADER_HPP
+#define ENDLESSH_REPORT_INCLUDE_LOGREADER_HPP
+
+#include "tagscanner.hpp"
+
+// stl
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// libc
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// zlib
+#include <zlib.h>
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+/**
+ * @brief Reads a log file line by line without copying the lines.
+ *
+ * Regular files are mapped into memory and each line is passed to the caller as a slice of the mapping.
+ * Anything that can't be mapped (stdin, pipes, FIFOs) is read through a single reusable buffer instead.
+ * Gzip-compressed files (e.g. rotated logs) are detected by their magic bytes and decompressed into that buffer.
+ * Either way, memory usage stays flat regardless of the size of the log.
+ */
+class LogReader {
+    public: // +++ Constants +++
+        constexpr static size_t READ_BUFFER_SIZE = 1024 * 1024; //!< The size of the buffer used for non-mappable inputs
+        constexpr static uint32_t GZIP_BUFFER_SIZE = 256 * 1024; //!< The size of zlib's internal input buffer
+
+    public: // +++ Constructor / Destructor +++
+        LogReader() = default;
+        LogReader(const LogReader&) = delete;
+        LogReader& operator=(const LogReader&) = delete;
+        ~LogReader() { close(); }
+
+    public: // +++ Open / Close +++
+        /**
+         * @brief Opens the file at the given path for reading.
+         *
+         * @param path The path to the log file.
+         * @param startOffset The (uncompressed) byte offset to start reading at. Used to resume reading a growing log.
+         *
+         * @return true If the file was opened successfully.
+         * @return false Otherwise. errno is left untouched for the caller to inspect.
+         */
+        bool open(const string& path, const uint64_t startOffset = 0) {
+            close();
+
+            const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) { return false; }
+
+            m_startOffset = m_endOffset = startOffset;
+            return attach(fd, true);
+        }
+
+        /**
+         * @brief Prepares the reader to read from stdin.
+         *
+         * @return true Always; stdin is read through the buffered fallback if it can't be mapped.
+         */
+        bool openStdIn() {
+            close();
+            m_startOffset = m_endOffset = 0;
+            return attach(STDIN_FILENO, false);
+        }
+
+        /**
+         * @brief Releases the mapping and closes the underlying file descriptor, if owned.
+         */
+        void close() {
+            if (m_gzFile != nullptr) {
+                gzclose(m_gzFile);
+                m_gzFile = nullptr;
+            }
+
+            if (m_mapping != nullptr) {
+                munmap(const_cast<char*>(m_mapping), m_mappingSize);
+                m_mapping = nullptr;
+                m_mappingSize = 0;
+            }
+
+            if (m_fd >= 0 && m_ownsFd) {
+                ::close(m_fd);
+            }
+
+            m_fd = -1;
+            m_ownsFd = false;
+        }
+
+        /**
+         * @brief Gets a value indicating whether the input has been mapped into memory.
+         */
+        bool isMapped() const { return m_mapping != nullptr; }
+
+        /**
+         * @brief Gets a value indicating whether the input is gzip-compressed.
+         */
+        bool isCompressed() const { return m_gzFile != nullptr; }
+
+        uint64_t getDevice() const { return m_device; } //!< The device the input resides on
+        uint64_t getInode() const { return m_inode; } //!< The inode of the input; identifies a log file across renames
+        uint64_t getFileSize() const { return m_fileSize; } //!< The (compressed) size of the input, if it's a regular file
+
+        /**
+         * @brief Sets the (uncompressed) byte offset to start reading at. Must be called before reading.
+         */
+        void setStartOffset(const uint64_t startOffset) { m_startOffset = m_endOffset = startOffset; }
+
+        /**
+         * @brief Sets the offset to stop reading at; must lie at the start of a line. Only honoured for mapped inputs.
+         */
+        void setStopOffset(const uint64_t stopOffset) { m_stopOffset = stopOffset; }
+
+        /**
+         * @brief Gets the whole mapped input (regardless of the start and stop offsets), or an empty view if the input isn't mapped.
+         */
+        string_view getMappedInput() const { return m_mapping == nullptr ? string_view() : string_view(m_mapping, m_mappingSize); }
+
+        /**
+         * @brief Gets the offset just past the last line passed to a handler.
+         *
+         * After reading, this is the offset to resume reading at in a later run.
+         */
+        uint64_t getEndOffset() const { return m_endOffset; }
+
+        /**
+         * @brief Gets the amount of (uncompressed) bytes consumed so far.
+         */
+        uint64_t getBytesRead() const { return m_endOffset - m_startOffset; }
+
+        /**
+         * @brief Sets whether to count the lines read (@see getLineCount); off by default, as it slows reading down.
+         *
+         * The lines are counted in the same pass as they're split, a cache-sized slice at a time.
+         */
+        void setLineCounting(const bool isCountingLines) { m_isCountingLines = isCountingLines; }
+
+        /**
+         * @brief Gets the amount of lines read, if counting lines is enabled.
+         */
+        uint64_t getLineCount() const { return m_lineCount; }
+
+        /**
+         * @brief Counts the lines in a block of memory; a trailing line without terminator counts as well.
+         */
+        static uint64_t countLines(const string_view block) {
+            const char* position = block.data();
+            const char* const end = position + block.size();
+            uint64_t lineCount = block.empty() || block.back() == '\n' ? 0 : 1;
+
+            // Several times faster than std::count, as memchr is vectorised
+            while ((position = static_cast<const char*>(memchr(position, '\n', end - position))) != nullptr) {
+                lineCount++;
+                position++;
+            }
+
+            return lineCount;
+        }
+
+    public: // +++ Reading +++
+        /**
+         * @brief Calls the given handler for each line in the input which contains the given tag.
+         *
+         * Rather than splitting the input into lines and searching each of them, the input is searched for the tag
+         * as a whole (@see findTag) and only the lines around the matches are extracted.
+         * Inputs in which few lines contain the tag, like a syslog, are thus skipped at close to memory bandwidth.
+         *
+         * The string_view passed to the handler is only valid for the duration of the call.
+         * Line terminators are not part of the passed line.
+         *
+         * @tparam LineHandler A callable accepting a string_view.
+         *
+         * @param tag The tag to search for; must not contain a line terminator. An empty tag matches every line.
+         * @param handler The handler to call for each matching line.
+         * @param includeIncompleteLine Whether to pass a trailing line without terminator to the handler.
+         *                              Set this to false when reading a log which is still being written to.
+         *
+         * @return true If the input was read in its entirety.
+         * @return false If a read error occurred.
+         */
+        template<typename LineHandler>
+        bool forEachLineContaining(const string_view tag, LineHandler&& handler, const bool includeIncompleteLine = true) {
+            if (m_fd < 0) { return false; }
+
+            if (m_mapping != nullptr) {
+                const auto mappedEnd = getMappedEnd();
+                if (m_startOffset < mappedEnd) {
+                    const auto* input = m_mapping + m_startOffset;
+                    const auto inputLength = mappedEnd - m_startOffset;
+
+                    m_endOffset += m_isCountingLines ? splitAndCountLines(input, inputLength, tag, handler, includeIncompleteLine, m_lineCount)
+                                                     : splitLines(input, inputLength, tag, handler, includeIncompleteLine);
+                }
+                return true;
+            }
+
+            return readBuffered(tag, handler, includeIncompleteLine);
+        }
+
+        /**
+         * @brief Splits the mapped input into (at most) the given amount of chunks of roughly equal size.
+         *
+         * Chunks always end on a line boundary, so every line is contained in exactly one chunk.
+         * Inputs which couldn't be mapped can't be split; an empty vector is returned for these.
+         *
+         * @param maxChunks The maximum amount of chunks to split the input into.
+         *
+         * @return vector<string_view> The chunks, in the order they appear in the input.
+         */
+        vector<string_view> getChunks(const size_t maxChunks) const {
+            vector<string_view> chunks;
+            if (m_mapping == nullptr || maxChunks == 0) { return chunks; }
+
+            const auto mappedEnd = getMappedEnd();
+            size_t chunkStart = std::min<size_t>(m_startOffset, mappedEnd);
+            const auto targetSize = (mappedEnd - chunkStart) / maxChunks + 1;
+
+            while (chunkStart < mappedEnd) {
+                size_t chunkEnd = chunkStart + targetSize;
+
+                if (chunkEnd >= mappedEnd) {
+                    chunkEnd = mappedEnd;
+                } else {
+                    const auto* newline = static_cast<const char*>(memchr(m_mapping + chunkEnd, '\n', mappedEnd - chunkEnd));
+                    chunkEnd = newline == nullptr ? mappedEnd : (newline - m_mapping) + 1;
+                }
+
+                chunks.emplace_back(m_mapping + chunkStart, chunkEnd - chunkStart);
+                chunkStart = chunkEnd;
+            }
+
+            return chunks;
+        }
+
+        /**
+         * @brief Calls the given handler for each line in a chunk of memory, e.g. one obtained from @see getChunks.
+         *
+         * @tparam LineHandler A callable accepting a string_view.
+         *
+         * @param chunk The chunk to split into lines.
+         * @param handler The handler to call for each line.
+         */
+        template<typename LineHandler>
+        static void forEachLineIn(const string_view chunk, LineHandler&& handler) {
+            splitLines(chunk.data(), chunk.size(), {}, handler, true);
+        }
+
+        /**
+         * @brief Calls the given handler for each line in a chunk of memory which contains the given tag.
+         *
+         * @see forEachLineContaining
+         */
+        template<typename LineHandler>
+        static void forEachLineContainingIn(const string_view chunk, const string_view tag, LineHandler&& handler) {
+            splitLines(chunk.data(), chunk.size(), tag, handler, true);
+        }
+
+        /**
+         * @brief Calls the given handler for each line in a chunk of memory which contains the given tag, counting all of its lines in the same pass.
+         *
+         * @see forEachLineContaining
+         *
+         * @param lineCount Will have the amount of lines in the chunk added to it.
+         */
+        template<typename LineHandler>
+        static void forEachLineContainingIn(const string_view chunk, const string_view tag, LineHandler&& handler, uint64_t& lineCount) {
+            splitAndCountLines(chunk.data(), chunk.size(), tag, handler, true, lineCount);
+        }
+
+    private: // +++ Implementation +++
+        void addLineCount(const char* data, const size_t length) {
+            if (m_isCountingLines) { m_lineCount += countLines(string_view(data, length)); }
+        }
+
+        size_t getMappedEnd() const { return static_cast<size_t>(std::min<uint64_t>(m_mappingSize, m_stopOffset)); }
+
+        bool attach(const int32_t fd, const bool ownsFd) {
+            m_fd = fd;
+            m_ownsFd = ownsFd;
+
+            struct stat fileInfo{};
+            if (fstat(fd, &fileInfo) == 0) {
+                m_device = static_cast<uint64_t>(fileInfo.st_dev);
+                m_inode = static_cast<uint64_t>(fileInfo.st_ino);
+                m_fileSize = S_ISREG(fileInfo.st_mode) ? static_cast<uint64_t>(fileInfo.st_size) : 0;
+            } else {
+                return true;
+            }
+
+            if (!S_ISREG(fileInfo.st_mode) || fileInfo.st_size == 0) {
+                // Not a regular file (or empty); fall back to buffered reads
+                return true;
+            }
+
+            uint8_t magic[2] = { 0 };
+            if (pread(fd, magic, sizeof(magic), 0) == sizeof(magic) && magic[0] == 0x1f && magic[1] == 0x8b) {
+                // gzip-compressed; zlib takes ownership of the descriptor it's given, so hand it a duplicate
+                const auto gzFd = dup(fd);
+                if (gzFd < 0 || (m_gzFile = gzdopen(gzFd, "rb")) == nullptr) {
+                    if (gzFd >= 0) { ::close(gzFd); }
+                    return false;
+                }
+
+                gzbuffer(m_gzFile, GZIP_BUFFER_SIZE);
+                return true;
+            }
+
+            m_mappingSize = static_cast<size_t>(fileInfo.st_size);
+            void* mapping = mmap(nullptr, m_mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (mapping == MAP_FAILED) {
+                m_mappingSize = 0;
+                return true;
+            }
+
+            madvise(mapping, m_mappingSize, MADV_SEQUENTIAL);
+            m_mapping = static_cast<const char*>(mapping);
+
+            return true;
+        }
+
+        /**
+         * @brief Splits a block of memory into lines and passes those containing the tag to the handler.
+         *
+         * @return size_t The amount of bytes consumed. If isFinal is false, a trailing incomplete line isn't consumed.
+         */
+        template<typename LineHandler>
+        static size_t splitLines(const char* data, const size_t length, const string_view tag, LineHandler& handler, const bool isFinal) {
+            if (!tag.empty()) { return splitMatchingLines(data, length, tag, handler, isFinal); }
+
+            const char* lineStart = data;
+            const char* const end = data + length;
+
+            while (lineStart < end) {
+                const auto* lineEnd = static_cast<const char*>(memchr(lineStart, '\n', end - lineStart));
+
+                if (lineEnd == nullptr) {
+                    if (!isFinal) { break; }
+                    lineEnd = end;
+                }
+
+                handler(string_view(lineStart, lineEnd - lineStart));
+                lineStart = lineEnd + 1;
+            }
+
+            return lineStart > end ? length : lineStart - data;
+        }
+
+        /**
+         * @brief Splits a block of memory like @see splitLines, and adds the amount of lines consumed to lineCount.
+         *
+         * The block is split a slice of about READ_BUFFER_SIZE at a time, and each slice is counted right after it's split,
+         * while it's still cached, so counting doesn't take a second pass over memory.
+         */
+        template<typename LineHandler>
+        static size_t splitAndCountLines(const char* data, const size_t length, const string_view tag, LineHandler& handler, const bool isFinal, uint64_t& lineCount) {
+            size_t sliceStart = 0;
+
+            while (length - sliceStart > READ_BUFFER_SIZE) {
+                // Slices end on a line boundary, so no line is split across two of them
+                const auto* searchStart = data + sliceStart + READ_BUFFER_SIZE;
+                const auto* newline = static_cast<const char*>(memchr(searchStart, '\n', data + length - searchStart));
+                if (newline == nullptr) { break; }
+
+                const auto sliceLength = static_cast<size_t>(newline + 1 - (data + sliceStart));
+                splitLines(data + sliceStart, sliceLength, tag, handler, true);
+                lineCount += countLines(string_view(data + sliceStart, sliceLength));
+                sliceStart += sliceLength;
+            }
+
+            const auto bytesConsumed = splitLines(data + sliceStart, length - sliceStart, tag, handler, isFinal);
+            lineCount += countLines(string_view(data + sliceStart, bytesConsumed));
+
+            return sliceStart + bytesConsumed;
+        }
+
+        /**
+         * @brief Searches a block of memory for the tag and passes the lines containing it to the handler.
+         *
+         * @see splitLines
+         */
+        template<typename LineHandler>
+        static size_t splitMatchingLines(const char* data, const size_t length, const string_view tag, LineHandler& handler, const bool isFinal) {
+            const char* position = data; // Always at the start of a line
+            const char* const end = data + length;
+            const auto searchFunction = getTagSearchFunction();
+
+            while (position < end) {
+                const auto* match = searchFunction(position, end - position, tag);
+                if (match == nullptr) { break; }
+
+                const auto* lineStart = static_cast<const char*>(memrchr(position, '\n', match - position));
+                lineStart = lineStart == nullptr ? position : lineStart + 1;
+
+                const auto* matchEnd = match + tag.size();
+                const auto* lineEnd = static_cast<const char*>(memchr(matchEnd, '\n', end - matchEnd));
+
+                if (lineEnd == nullptr) {
+                    if (!isFinal) { return lineStart - data; }
+                    lineEnd = end;
+                }
+
+                handler(string_view(lineStart, lineEnd - lineStart));
+                position = lineEnd + 1;
+            }
+
+            if (isFinal || position >= end) { return length; }
+
+            // Only consume up to the last complete line, so a tag split across reads is still found
+            const auto* lastNewline = static_cast<const char*>(memrchr(position, '\n', end - position));
+            return lastNewline == nullptr ? position - data : (lastNewline - data) + 1;
+        }
+
+        template<typename LineHandler>
+        bool readBuffered(const string_view tag, LineHandler& handler, const bool includeIncompleteLine) {
+            if (m_buffer.size() < READ_BUFFER_SIZE) { m_buffer.resize(READ_BUFFER_SIZE); }
+            if (m_startOffset > 0 && !skipInput(m_startOffset)) { return false; }
+
+            size_t bytesPending = 0;
+
+            while (true) {
+                if (bytesPending == m_buffer.size()) {
+                    // A single line doesn't fit in the buffer; grow it
+                    m_buffer.resize(m_buffer.size() * 2);
+                }
+
+                const auto bytesRead = readInput(m_buffer.data() + bytesPending, m_buffer.size() - bytesPending);
+
+                if (bytesRead < 0) {
+                    if (errno == EINTR && m_gzFile == nullptr) { continue; }
+                    return false;
+                } else if (bytesRead == 0) {
+                    const auto bytesConsumed = splitLines(m_buffer.data(), bytesPending, tag, handler, includeIncompleteLine);
+                    addLineCount(m_buffer.data(), bytesConsumed);
+                    m_endOffset += bytesConsumed;
+                    return true;
+                }
+
+                bytesPending += static_cast<size_t>(bytesRead);
+
+                const auto bytesConsumed = splitLines(m_buffer.data(), bytesPending, tag, handler, false);
+                addLineCount(m_buffer.data(), bytesConsumed);
+                bytesPending -= bytesConsumed;
+                m_endOffset += bytesConsumed;
+
+                if (bytesPending > 0 && bytesConsumed > 0) {
+                    memmove(m_buffer.data(), m_buffer.data() + bytesConsumed, bytesPending);
+                }
+            }
+        }
+
+        /**
+         * @brief Skips the given amount of (uncompressed) bytes at the start of a non-mapped input.
+         *
+         * @return true If the bytes were skipped, or the input ended before that.
+         * @return false If a read error occurred.
+         */
+        bool skipInput(uint64_t bytesToSkip) {
+            if (m_gzFile != nullptr) {
+                // zlib has to decompress everything up to the offset anyway; gzseek does just that
+                return gzseek(m_gzFile, static_cast<z_off_t>(bytesToSkip), SEEK_SET) >= 0 || gzeof(m_gzFile);
+            } else if (lseek(m_fd, static_cast<off_t>(bytesToSkip), SEEK_CUR) >= 0) {
+                return true;
+            }
+
+            while (bytesToSkip > 0) {
+                const auto bytesRead = ::read(m_fd, m_buffer.data(), std::min<uint64_t>(bytesToSkip, m_buffer.size()));
+                if (bytesRead < 0 && errno == EINTR) { continue; }
+                if (bytesRead <= 0) { return bytesRead == 0; }
+                bytesToSkip -= static_cast<uint64_t>(bytesRead);
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Reads (and decompresses, if required) up to length bytes of the input.
+         *
+         * @return ssize_t The amount of bytes read, 0 at the end of the input or -1 on error.
+         */
+        ssize_t readInput(char* buffer, const size_t length) {
+            if (m_gzFile != nullptr) {
+                const auto bytesRead = gzread(m_gzFile, buffer, static_cast<uint32_t>(std::min<size_t>(length, UINT32_MAX >> 1)));
+                if (bytesRead < 0 && errno == 0) { errno = EIO; }
+                return bytesRead;
+            }
+
+            return ::read(m_fd, buffer, length);
+        }
+
+    private: // +++ Members +++
+        int32_t         m_fd{-1}; //!< The file descriptor being read
+        bool            m_ownsFd{false}; //!< Whether or not the file descriptor must be closed by this instance
+
+        uint64_t        m_device{0}; //!< The device the input resides on
+        uint64_t        m_inode{0}; //!< The inode of the input
+        uint64_t        m_fileSize{0}; //!< The size of the input, if it's a regular file
+        uint64_t        m_startOffset{0}; //!< The offset reading starts at
+        uint64_t        m_endOffset{0}; //!< The offset just past the last line passed to a handler
+        uint64_t        m_stopOffset{UINT64_MAX}; //!< The offset reading stops at (mapped inputs only)
+        uint64_t        m_lineCount{0}; //!< The amount of lines read, if counted
+        bool            m_isCountingLines{false}; //!< Whether or not to count the lines read
+
+        const char*     m_mapping{nullptr}; //!< The mapped file, if the input could be mapped
+        size_t          m_mappingSize{0}; //!< The size of the mapping
+
+        gzFile          m_gzFile{nullptr}; //!< The zlib handle, if the input is gzip-compressed
+
+        vector<char>    m_buffer; //!< The buffer used for inputs which can't be mapped
+};
+
+#endif // ENDLESSH_REPORT_INCLUDE_LOGREADER_HPP
@@ -30,7 +30,7 @@ using std::string_view;
  * 
  * @return constexpr string_view The arg string as required for @see getopt_long
  */
-constexpr string_view   getAppArgs() { return R"(icsandhvS:)"; }
+constexpr string_view   getAppArgs() { return R"(icsandhvmopAS:t:f:F:e:b:u:T:k:j:g:M:x:w:X:W:r:R:P:)"; }
 
 /**
  * @brief Gets the application's command-line options for @see getopt_long.
@@ -47,6 +47,28 @@ const option*           getAppOptions() {
         { "help",           no_argument,        nullptr,    'h' },
         { "syslog",         required_argument,  nullptr,    'S' },
         { "version",        no_argument,        nullptr,    'v' },
+        { "threads",        required_argument,  nullptr,    't' },
+        { "state",          required_argument,  nullptr,    'f' },
+        { "follow",         required_argument,  nullptr,    'F' },
+        { "export",         required_argument,  nullptr,    'e' },
+        { "merge",          no_argument,        nullptr,    'm' },
+        { "open-connections", no_argument,      nullptr,    'o' },
+        { "since",          required_argument,  nullptr,    'b' },
+        { "until",          required_argument,  nullptr,    'u' },
+        { "top",            required_argument,  nullptr,    'T' },
+        { "sort-by",        required_argument,  nullptr,    'k' },
+        { "profile",        no_argument,        nullptr,    'p' },
+        { "profile-json",   required_argument,  nullptr,    'j' },
+        { "approximate",    no_argument,        nullptr,    'A' },
+        { "group-by-prefix", required_argument, nullptr,    'g' },
+        { "min-hosts",      required_argument,  nullptr,    'M' },
+        { "exclude-cidr",   required_argument,  nullptr,    'x' },
+        { "include-cidr",   required_argument,  nullptr,    'w' },
+        { "exclude-cidr-file", required_argument, nullptr,  'X' },
+        { "include-cidr-file", required_argument, nullptr,  'W' },
+        { "abuse-ipdb-split", required_argument, nullptr,   'P' },
+        { "reported-index", required_argument,  nullptr,    'r' },
+        { "report-cooldown", required_argument, nullptr,    'R' },
         { nullptr,          no_argument,        nullptr,     0  }
     };
 
@@ -68,6 +90,18 @@ Usage:
     {0:s}
     {0:s} [options]
     {0:s} --syslog/var/log/syslog.1
+    {0:s} --syslog '/var/log/syslog*' --threads 0
+    {0:s} [options] <file> [files...]
+    {0:s} --syslog /var/log/syslog --follow 300
+    {0:s} --since 24h
+    {0:s} --since 2023-10-01 --until "2023-10-15 12:00"
+    {0:s} --detailed --top 50 --sort-by time
+    {0:s} --approximate --top 20
+    {0:s} --group-by-prefix 24,48 --min-hosts 4
+    {0:s} --abuse-ipdb --exclude-cidr-file /etc/endlessh-report/ignored.txt
+    {0:s} --abuse-ipdb --reported-index /var/lib/endlessh-report/reported.idx --report-cooldown 24h
+    {0:s} --detailed --export <host>.snapshot
+    {0:s} --detailed --merge <snapshot> [snapshots...]
     cat <file> | {0:s} --stdin
 
 Switches:
@@ -77,11 +111,47 @@ Switches:
     --abuse-ipdb,   -a      Enable AbuseIPDB-compatible CSV output
     --no-ad,        -n      No advertising please!
     --detailed,     -d      Provide detailed information
+    --merge,        -m      Merge snapshot files (see --export) instead of reading logs
+    --open-connections, -o  List the connections which are still open
+    --profile,      -p      Print the time spent in each stage, throughput and peak memory usage to stderr
+    --approximate,  -A      Estimate the unique IPs and the top hosts by accepted connections in a fixed
+                            few MiB of memory, for logs with too many hosts to count exactly (default top: 100).
+                            Connections aren't tracked, so the alive connections are estimated from the totals
     --help,         -h      Show this text and exit
     --version,      -v      Display version information and exit
 
 Arguments:
-    --syslog [f],   -S[f]   Override syslog/endlessh log location
+    --syslog [f],   -S[f]   Override syslog/endlessh log location; may be repeated and may be a glob.
+                            Gzip-compressed logs (e.g. syslog.2.gz) are decompressed on the fly.
+                            Multiple logs are read oldest first (by modification time, then rotation suffix).
+    --threads [n],  -t[n]   Parse the log using n threads (0: one per core; at most 1024; default: 1)
+                            Multiple logs are split into chunks which idle threads take over from busy ones.
+    --state [f],    -f[f]   Incremental mode: only parse what was appended to the log since the last run
+                            and report the totals accumulated in state file f (e.g. for cron jobs)
+    --follow [n],   -F[n]   Keep following the log (across rotations) and print a report every n seconds
+                            (0: only when SIGUSR1 is received). A report is also printed on SIGUSR1.
+    --export [f],   -e[f]   Export the aggregated statistics to snapshot file f, e.g. to merge them with
+                            those of other hosts. Snapshots must be merged in the mode they were taken in.
+    --since [t],    -b[t]   Only report entries logged at or after t: a local date and time (2023-10-16,
+                            "2023-10-16 12:00:00") or a duration ago (30s, 15m, 24h, 7d, 2w)
+    --until [t],    -u[t]   Only report entries logged at or before t (a date alone includes the whole day)
+    --top [n],      -T[n]   Only report the n hosts ranking highest (see --sort-by; default: accepted)
+    --sort-by [f],  -k[f]   Rank hosts by accepted, closed, ports, time or bytes, highest first
+                            (ports, time and bytes require --detailed)
+    --profile-json [f], -j[f] Like --profile, but append the profile to file f as a line of JSON
+    --group-by-prefix [v4[,v6]], -g[v4[,v6]]
+                            Report statistics per prefix of v4/v6 bits (e.g. 24,48; v6 is 48 if omitted) instead of per host
+    --min-hosts [n], -M[n]  With --group-by-prefix, fold prefixes with fewer than n hosts into the
+                            longest prefix they share with others
+    --exclude-cidr [l], -x[l] Don't report hosts within the comma-separated prefixes l (e.g. 203.0.113.0/24,2001:db8::/32)
+    --include-cidr [l], -w[l] Only report hosts within the comma-separated prefixes l; exclusions take precedence
+    --exclude-cidr-file [f], -X[f] Like --exclude-cidr, reading one prefix per line from file f (# starts a comment)
+    --include-cidr-file [f], -W[f] Like --include-cidr, reading one prefix per line from file f
+    --abuse-ipdb-split [p], -P[p] Like --abuse-ipdb, but write the CSV to p-0001.csv, p-0002.csv, ... of at most
+                            10,000 lines and 2 MB each (AbuseIPDB's bulk report limits) and print their paths
+    --reported-index [f], -r[f] With --abuse-ipdb, only report hosts not reported in the last cooldown (see
+                            --report-cooldown), as recorded in index file f; reported hosts are added to it
+    --report-cooldown [d], -R[d] The time before a host may be reported again: 30s, 15m, 24h, 7d, ... (default: 15m)
 )";
 
     return fmt::format(HELP_TEXT_FMT, binName, getApplicationVersion(), getProjectDescription());
@@ -0,0 +1,116 @@
+/**
+ * @file portset.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains a bounded set of the source ports used by a host.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_PORTSET_HPP
+#define ENDLESSH_REPORT_INCLUDE_PORTSET_HPP
+
+// stl
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+using std::unique_ptr;
+using std::vector;
+
+/**
+ * @brief A set of distinct ports, whose size is bounded regardless of how often ports are added.
+ *
+ * Few ports are kept in a sorted vector. Once storing them that way would take up more space than a bitmap of all
+ * 65536 ports (8 KiB), the set is promoted to such a bitmap. Either way, adding a port that's already in the set
+ * doesn't cost any memory.
+ *
+ * The sorted ports are allocated from the given memory resource, so the sets of many hosts can share a pool
+ * (@see HostTable) instead of each growing its own vector on the heap.
+ */
+class PortSet {
+    public: // +++ Constants +++
+        constexpr static uint32_t PORT_COUNT = 65536; //!< The amount of possible ports
+        constexpr static uint32_t BITMAP_WORDS = PORT_COUNT / 64; //!< The size of the bitmap, in 64-bit words
+        constexpr static size_t MAX_SORTED_PORTS = PORT_COUNT / 8 / sizeof(uint16_t); //!< The amount of ports at which the set is promoted to a bitmap
+
+    public: // +++ Constructor / Destructor +++
+        explicit PortSet(std::pmr::memory_resource* memory = std::pmr::get_default_resource()): m_sortedPorts(memory) {}
+        PortSet(PortSet&&) = default;
+        PortSet& operator=(PortSet&&) = default;
+        ~PortSet() = default;
+
+    public: // +++ Modification +++
+        /**
+         * @brief Adds a port to the set.
+         *
+         * @param port The port to add.
+         */
+        void insert(const uint16_t port) {
+            if (m_bitmap != nullptr) {
+                auto& word = m_bitmap[port / 64];
+                const auto bit = uint64_t(1) << (port % 64);
+
+                m_size += (word & bit) == 0 ? 1 : 0;
+                word |= bit;
+                return;
+            }
+
+            const auto position = std::lower_bound(m_sortedPorts.begin(), m_sortedPorts.end(), port);
+            if (position != m_sortedPorts.end() && *position == port) { return; }
+
+            m_sortedPorts.insert(position, port);
+            m_size++;
+
+            if (m_sortedPorts.size() >= MAX_SORTED_PORTS) { promote(); }
+        }
+
+        /**
+         * @brief Adds all ports of another set to this one.
+         */
+        void merge(const PortSet& other) {
+            other.forEach([this](const uint16_t port) { insert(port); });
+        }
+
+    public: // +++ Queries +++
+        size_t size() const { return m_size; } //!< The amount of distinct ports in the set
+        bool empty() const { return m_size == 0; }
+
+        /**
+         * @brief Calls the given function for each port in the set, in ascending order.
+         */
+        template<typename Function>
+        void forEach(Function&& function) const {
+            if (m_bitmap == nullptr) {
+                for (const auto port : m_sortedPorts) { function(port); }
+                return;
+            }
+
+            for (uint32_t i = 0; i < BITMAP_WORDS; i++) {
+                for (auto word = m_bitmap[i]; word != 0; word &= word - 1) {
+                    function(static_cast<uint16_t>(i * 64 + __builtin_ctzll(word)));
+                }
+            }
+        }
+
+    private: // +++ Implementation +++
+        void promote() {
+            m_bitmap.reset(new uint64_t[BITMAP_WORDS]());
+
+            for (const auto port : m_sortedPorts) {
+                m_bitmap[port / 64] |= uint64_t(1) << (port % 64);
+            }
+
+            std::pmr::vector<uint16_t>(m_sortedPorts.get_allocator()).swap(m_sortedPorts);
+        }
+
+    private: // +++ Members +++
+        std::pmr::vector<uint16_t>  m_sortedPorts; //!< The ports, while there are few of them
+        unique_ptr<uint64_t[]>      m_bitmap; //!< One bit per port, once there are many of them
+        size_t                      m_size{0}; //!< The amount of distinct ports
+};
+
+#endif // ENDLESSH_REPORT_INCLUDE_PORTSET_HPP
@@ -0,0 +1,267 @@
+/**
+ * @file prefixtrie.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains the rollup of per-host statistics into statistics per network prefix (e.g. per /24 or /48).
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_PREFIXTRIE_HPP
+#define ENDLESSH_REPORT_INCLUDE_PREFIXTRIE_HPP
+
+#include "ipaddress.hpp"
+
+// stl
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+// libc
+#include <arpa/inet.h>
+
+using std::string_view;
+using std::vector;
+
+/**
+ * @brief A network prefix, such as 203.0.113.0/24 or 2001:db8::/48.
+ *
+ * Prefixes live in the same 128-bit space as @see IpAddress, where IPv4 addresses are mapped to ::ffff:0:0/96;
+ * an IPv4 prefix of length n therefore has a length of 96 + n.
+ */
+struct IpPrefix {
+    constexpr static size_t MAX_CHARS = INET6_ADDRSTRLEN + 4; //!< The maximum length of a prefix as text, including the terminator
+
+    IpAddress   address; //!< The address, with all bits past length cleared
+    uint32_t    length{0}; //!< The amount of leading bits which make up the prefix, 0 - 128
+
+    /**
+     * @brief Gets the prefix of the given length an address lies in.
+     */
+    static IpPrefix of(const IpAddress& address, const uint32_t length) {
+        IpPrefix prefix;
+        prefix.address.high = length == 0 ? 0 : length >= 64 ? address.high : address.high & (~uint64_t(0) << (64 - length));
+        prefix.address.low = length <= 64 ? 0 : length >= 128 ? address.low : address.low & (~uint64_t(0) << (128 - length));
+        prefix.length = length;
+
+        return prefix;
+    }
+
+    /**
+     * @brief Gets the bit at the given position, counting from the most significant one.
+     */
+    static uint32_t getBit(const IpAddress& address, const uint32_t position) {
+        return position < 64 ? (address.high >> (63 - position)) & 1 : (address.low >> (127 - position)) & 1;
+    }
+
+    /**
+     * @brief Gets the amount of leading bits two addresses have in common.
+     */
+    static uint32_t getCommonLength(const IpAddress& a, const IpAddress& b) {
+        if (a.high != b.high) { return __builtin_clzll(a.high ^ b.high); }
+        if (a.low != b.low) { return 64 + __builtin_clzll(a.low ^ b.low); }
+
+        return 128;
+    }
+
+    bool isV4() const { return length >= 96 && address.isV4(); }
+
+    /**
+     * @brief Writes the prefix in CIDR notation (IPv4 prefixes in dotted-decimal form).
+     *
+     * @param buffer A buffer of at least MAX_CHARS.
+     */
+    string_view toChars(char* buffer) const {
+        const auto addressLength = address.toChars(buffer).size();
+        const auto totalLength = addressLength + std::snprintf(buffer + addressLength, MAX_CHARS - addressLength, "/%u", isV4() ? length - 96 : length);
+
+        return string_view(buffer, totalLength);
+    }
+};
+
+/**
+ * @brief Contains the statistics of all hosts within a prefix.
+ */
+struct PrefixStatistics {
+    uint32_t    hosts{0}; //!< The amount of unique hosts within the prefix
+    uint64_t    acceptedConnections{0}; //!< The amount of accepted connections
+    uint64_t    closedConnections{0}; //!< The amount of closed connections
+    uint64_t    totalMillisecondsWasted{0}; //!< The milliseconds of bot time wasted (detailed only)
+    uint64_t    totalBytesSent{0}; //!< The amount of bytes sent (detailed only)
+
+    double getSecondsWasted() const { return totalMillisecondsWasted / 1000.0; }
+
+    PrefixStatistics& operator+=(const PrefixStatistics& other) {
+        hosts += other.hosts;
+        acceptedConnections += other.acceptedConnections;
+        closedConnections += other.closedConnections;
+        totalMillisecondsWasted += other.totalMillisecondsWasted;
+        totalBytesSent += other.totalBytesSent;
+        return *this;
+    }
+};
+
+/**
+ * @brief Rolls up statistics into prefixes, kept in a compressed (PATRICIA) binary radix trie.
+ *
+ * Each node holds a prefix; its children hold longer prefixes within it, split by the first bit following it. Nodes
+ * with a single child are never created, so the trie holds at most twice as many nodes as there are prefixes, and each
+ * inner node is the longest prefix its subtree has in common. That makes inner nodes the natural prefixes to fold
+ * sparsely populated ones into (@see foldPrefixesBelow).
+ *
+ * The nodes are kept in a single vector and linked by index.
+ */
+class PrefixTrie {
+    public: // +++ Types +++
+        /**
+         * @brief A prefix holding statistics, as returned by @see getPrefixes.
+         */
+        struct Entry {
+            IpPrefix            prefix; //!< The prefix
+            PrefixStatistics    statistics; //!< The statistics of the hosts within it
+        };
+
+    public: // +++ Modification +++
+        /**
+         * @brief Adds statistics to a prefix, inserting it if it isn't in the trie yet.
+         */
+        void add(const IpPrefix& prefix, const PrefixStatistics& statistics) {
+            if (m_root == NO_NODE) {
+                m_root = addNode(prefix);
+                m_nodes[m_root].addStatistics(statistics);
+                return;
+            }
+
+            auto index = m_root;
+            int32_t parent = NO_NODE;
+            int32_t side = 0;
+
+            while (true) {
+                const auto nodePrefix = m_nodes[index].entry.prefix;
+                const auto commonLength = std::min({ IpPrefix::getCommonLength(prefix.address, nodePrefix.address), prefix.length, nodePrefix.length });
+
+                if (commonLength == nodePrefix.length && commonLength == prefix.length) {
+                    m_nodes[index].addStatistics(statistics);
+                    return;
+                }
+
+                if (commonLength == nodePrefix.length) {
+                    // The prefix lies within the node's; descend, or become its child
+                    parent = index;
+                    side = static_cast<int32_t>(IpPrefix::getBit(prefix.address, commonLength));
+
+                    if (m_nodes[index].children[side] == NO_NODE) {
+                        const auto child = addNode(prefix);
+                        m_nodes[child].addStatistics(statistics);
+                        m_nodes[parent].children[side] = child;
+                        return;
+                    }
+
+                    index = m_nodes[parent].children[side];
+                    continue;
+                }
+
+                // The prefix diverges from (or contains) the node's; split at the common part
+                const auto branch = addNode(IpPrefix::of(prefix.address, commonLength));
+                m_nodes[branch].children[IpPrefix::getBit(nodePrefix.address, commonLength)] = index;
+
+                if (commonLength == prefix.length) {
+                    m_nodes[branch].addStatistics(statistics);
+                } else {
+                    const auto leaf = addNode(prefix);
+                    m_nodes[leaf].addStatistics(statistics);
+                    m_nodes[branch].children[IpPrefix::getBit(prefix.address, commonLength)] = leaf;
+                }
+
+                (parent == NO_NODE ? m_root : m_nodes[parent].children[side]) = branch;
+                return;
+            }
+        }
+
+        /**
+         * @brief Folds the statistics of each prefix with fewer than the given amount of hosts into its parent prefix.
+         *
+         * The trie is folded bottom-up, so a parent which is still too small after taking in its children is folded
+         * further up in turn. IPv4 prefixes are never folded into prefixes spanning more than the IPv4 space, and the
+         * shortest prefix is kept however small it is.
+         *
+         * @param minHosts The minimum amount of hosts a prefix must contain to keep its own entry.
+         */
+        void foldPrefixesBelow(const uint32_t minHosts) {
+            if (m_root != NO_NODE) { foldChildren(m_root, minHosts); }
+        }
+
+    public: // +++ Results +++
+        /**
+         * @brief Gets the prefixes holding statistics, ordered by address (shorter prefixes first).
+         */
+        vector<Entry> getPrefixes() const {
+            vector<Entry> prefixes;
+            if (m_root != NO_NODE) { collectPrefixes(m_root, prefixes); }
+
+            return prefixes;
+        }
+
+    private: // +++ Types +++
+        constexpr static int32_t NO_NODE = -1;
+
+        struct Node {
+            Entry   entry; //!< The prefix and its statistics
+            bool    hasStatistics{false}; //!< Whether statistics were added to the prefix; false for mere branches
+            int32_t children[2] = { NO_NODE, NO_NODE }; //!< The longer prefixes continuing with a 0 and a 1 bit
+
+            void addStatistics(const PrefixStatistics& statistics) {
+                entry.statistics += statistics;
+                hasStatistics = true;
+            }
+        };
+
+    private: // +++ Implementation +++
+        int32_t addNode(const IpPrefix& prefix) {
+            m_nodes.emplace_back();
+            m_nodes.back().entry.prefix = prefix;
+
+            return static_cast<int32_t>(m_nodes.size() - 1);
+        }
+
+        void foldChildren(const int32_t index, const uint32_t minHosts) {
+            for (auto& childLink : m_nodes[index].children) {
+                if (childLink == NO_NODE) { continue; }
+
+                const auto child = childLink;
+                foldChildren(child, minHosts);
+
+                auto& childNode = m_nodes[child];
+                const auto isFoldable = !childNode.entry.prefix.isV4() || m_nodes[index].entry.prefix.isV4();
+
+                if (!childNode.hasStatistics || childNode.entry.statistics.hosts >= minHosts || !isFoldable) { continue; }
+
+                m_nodes[index].addStatistics(childNode.entry.statistics);
+                childNode.entry.statistics = {};
+                childNode.hasStatistics = false;
+
+                // Unlink the child if nothing is left beneath it; a single remaining child takes its place
+                if (childNode.children[0] == NO_NODE || childNode.children[1] == NO_NODE) {
+                    childLink = childNode.children[0] != NO_NODE ? childNode.children[0] : childNode.children[1];
+                }
+            }
+        }
+
+        void collectPrefixes(const int32_t index, vector<Entry>& prefixes) const {
+            const auto& node = m_nodes[index];
+            if (node.hasStatistics) { prefixes.push_back(node.entry); }
+
+            for (const auto child : node.children) {
+                if (child != NO_NODE) { collectPrefixes(child, prefixes); }
+            }
+        }
+
+    private: // +++ Members +++
+        vector<Node>    m_nodes; //!< All nodes, linked by index
+        int32_t         m_root{NO_NODE}; //!< The node holding the shortest prefix
+};
+
+#endif // ENDLESSH_REPORT_INCLUDE_PREFIXTRIE_HPP
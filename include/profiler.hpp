@@ -0,0 +1,309 @@
+/**
+ * @file profiler.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains the opt-in instrumentation measuring the time and throughput of each stage of a report.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_PROFILER_HPP
+#define ENDLESSH_REPORT_INCLUDE_PROFILER_HPP
+
+#include "extensions.hpp"
+
+// stl
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// libc
+#include <sys/resource.h>
+
+// fmt
+#include <fmt/format.h>
+
+using std::string;
+using std::string_view;
+
+/**
+ * @brief The stages of a report.
+ *
+ * Reading, filtering, parsing and aggregation happen in a single streaming pass; the last three are timed per line.
+ */
+enum class ProfileStage: uint8_t {
+    Read,       //!< Reading (and decompressing) the input and searching it for endlessh's entries
+    Filter,     //!< Filtering endlessh's entries by time (@see TimeWindow)
+    Parse,      //!< Tokenizing endlessh's entries
+    Aggregate,  //!< Adding the tokenized entries to the aggregates
+    Merge,      //!< Merging the partial results of several threads, or snapshot files
+    Output,     //!< Formatting and writing the report
+    Count       //!< The amount of stages
+};
+
+constexpr size_t PROFILE_STAGE_COUNT = static_cast<size_t>(ProfileStage::Count); //!< The amount of stages
+
+/**
+ * @brief Gets the name of a stage, as used in the profile.
+ */
+inline string_view getProfileStageName(const ProfileStage stage) {
+    constexpr static string_view NAMES[] = { "read", "filter", "parse", "aggregate", "merge", "output" };
+    return NAMES[static_cast<size_t>(stage)];
+}
+
+/**
+ * @brief The measurements a thread takes while passing lines to the aggregator; collected by @see Profiler::collectThreadSample.
+ */
+struct ProfileSample {
+    std::array<uint64_t, PROFILE_STAGE_COUNT> stageNanoseconds{}; //!< The time spent in each per-line stage, by the timed lines
+    uint64_t endlesshLines{0}; //!< The amount of lines containing the endlessh tag
+    uint64_t timedLines{0}; //!< The amount of those lines whose stages were timed
+    uint64_t events{0}; //!< The amount of entries tokenized successfully
+
+    /**
+     * @brief Adds the time between two clock readings (@see Profiler::getWallNanoseconds) to a stage, minus the cost of reading the clock.
+     */
+    void addTime(const ProfileStage stage, const uint64_t start, const uint64_t end);
+};
+
+/**
+ * @brief Measures the wall and CPU time of each stage of a report, along with the amount of data processed.
+ *
+ * The stages which run once (reading, merging and output) are timed as a whole (@see measureStage).
+ * The per-line stages are timed on every PROFILE_SAMPLE_INTERVAL-th line, as reading the clock takes about as long
+ * as aggregating a line. They're summed up in a thread-local @see ProfileSample, extrapolated and subtracted from the
+ * time of the read stage they're nested in, as is merging the results of several threads. The per-line stages are
+ * CPU-bound, so their CPU time is taken to be the time measured; when the log is read on several threads, their wall time
+ * is divided by the amount of threads.
+ */
+class Profiler {
+    public: // +++ Constants +++
+        constexpr static uint64_t PROFILE_SAMPLE_INTERVAL = 16; //!< Every how many lines the per-line stages are timed
+
+    public: // +++ Types +++
+        /**
+         * @brief Times a stage from its construction until its destruction. @see measureStage
+         */
+        class StageTimer {
+            public:
+                StageTimer(Profiler& profiler, const ProfileStage stage):
+                    m_profiler(profiler), m_stage(stage), m_wallStart(getWallNanoseconds()), m_cpuStart(getCpuNanoseconds()) {}
+                StageTimer(const StageTimer&) = delete;
+                StageTimer& operator=(const StageTimer&) = delete;
+                ~StageTimer() { m_profiler.addStageTime(m_stage, getWallNanoseconds() - m_wallStart, getCpuNanoseconds() - m_cpuStart); }
+
+            private:
+                Profiler&       m_profiler; //!< The profiler to add the time to
+                ProfileStage    m_stage; //!< The stage being timed
+                uint64_t        m_wallStart; //!< The wall time at the start of the stage
+                uint64_t        m_cpuStart; //!< The CPU time of the process at the start of the stage
+        };
+
+    public: // +++ Clocks +++
+        static uint64_t getWallNanoseconds() { return readClock(CLOCK_MONOTONIC); }
+        static uint64_t getCpuNanoseconds() { return readClock(CLOCK_PROCESS_CPUTIME_ID); } //!< The CPU time of all threads of the process
+
+        /**
+         * @brief Gets how long reading the wall clock takes, which is measured once.
+         */
+        static uint64_t getClockOverhead() {
+            static const uint64_t overhead = []() {
+                constexpr uint32_t READINGS = 1000;
+                const auto start = getWallNanoseconds();
+                for (uint32_t i = 0; i < READINGS; i++) { getWallNanoseconds(); }
+
+                return (getWallNanoseconds() - start) / (READINGS + 1);
+            }();
+
+            return overhead;
+        }
+
+        /**
+         * @brief Gets the sample of the calling thread, to add per-line measurements to.
+         */
+        static ProfileSample& getThreadSample() {
+            thread_local ProfileSample sample;
+            return sample;
+        }
+
+    public: // +++ Measuring +++
+        /**
+         * @brief Starts timing a stage; the stage ends when the returned timer is destroyed.
+         */
+        StageTimer measureStage(const ProfileStage stage) { return StageTimer(*this, stage); }
+
+        void addStageTime(const ProfileStage stage, const uint64_t wallNanoseconds, const uint64_t cpuNanoseconds) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stageWallNanoseconds[static_cast<size_t>(stage)] += wallNanoseconds;
+            m_stageCpuNanoseconds[static_cast<size_t>(stage)] += cpuNanoseconds;
+        }
+
+        /**
+         * @brief Adds the calling thread's sample to the profile and resets it. Must be called by each thread reading the log.
+         */
+        void collectThreadSample() {
+            auto& sample = getThreadSample();
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            // The timed lines are spread evenly, so they're representative of all lines
+            const auto scale = sample.timedLines == 0 ? 0.0 : static_cast<double>(sample.endlesshLines) / sample.timedLines;
+            for (size_t i = 0; i < PROFILE_STAGE_COUNT; i++) { m_perLineNanoseconds[i] += static_cast<uint64_t>(sample.stageNanoseconds[i] * scale); }
+            m_endlesshLines += sample.endlesshLines;
+            m_events += sample.events;
+
+            sample = ProfileSample{};
+        }
+
+        /**
+         * @brief Adds to the amount of input read.
+         */
+        void addInput(const uint64_t bytes, const uint64_t lines) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bytesRead += bytes;
+            m_linesRead += lines;
+        }
+
+        void setReadThreads(const uint32_t threadCount) { m_readThreads = std::max(1u, threadCount); } //!< The amount of threads the log is read on
+        void setUniqueHosts(const uint64_t uniqueHosts) { m_uniqueHosts = uniqueHosts; }
+
+    public: // +++ Results +++
+        /**
+         * @brief Gets the wall time of a stage, excluding the stages nested in it.
+         */
+        uint64_t getStageWallNanoseconds(const ProfileStage stage) const {
+            if (stage == ProfileStage::Read) {
+                return subtractNested(m_stageWallNanoseconds[0], getPerLineNanoseconds() / m_readThreads + m_stageWallNanoseconds[MERGE_INDEX]);
+            }
+
+            return m_stageWallNanoseconds[static_cast<size_t>(stage)] + m_perLineNanoseconds[static_cast<size_t>(stage)] / m_readThreads;
+        }
+
+        /**
+         * @brief Gets the CPU time of a stage, excluding the stages nested in it.
+         */
+        uint64_t getStageCpuNanoseconds(const ProfileStage stage) const {
+            if (stage == ProfileStage::Read) {
+                return subtractNested(m_stageCpuNanoseconds[0], getPerLineNanoseconds() + m_stageCpuNanoseconds[MERGE_INDEX]);
+            }
+
+            return m_stageCpuNanoseconds[static_cast<size_t>(stage)] + m_perLineNanoseconds[static_cast<size_t>(stage)];
+        }
+
+        uint64_t getTotalWallNanoseconds() const {
+            uint64_t total = 0;
+            for (size_t i = 0; i < PROFILE_STAGE_COUNT; i++) { total += getStageWallNanoseconds(static_cast<ProfileStage>(i)); }
+
+            return total;
+        }
+
+        /**
+         * @brief Gets the peak resident set size of the process, in bytes.
+         */
+        static uint64_t getPeakResidentBytes() {
+            struct rusage usage{};
+            getrusage(RUSAGE_SELF, &usage);
+            return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+        }
+
+        /**
+         * @brief Formats the profile in a human-readable table.
+         */
+        string formatText() const {
+            fmt::memory_buffer buffer;
+            auto output = std::back_inserter(buffer);
+            const auto totalSeconds = getTotalWallNanoseconds() / 1e9;
+
+            fmt::format_to(output, "# Profile\n{0:<10s} {1:>10s} {2:>10s}\n", "Stage", "Wall (s)", "CPU (s)");
+
+            for (size_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+                const auto stage = static_cast<ProfileStage>(i);
+                fmt::format_to(output, "{0:<10s} {1:>10.4f} {2:>10.4f}\n", getProfileStageName(stage), getStageWallNanoseconds(stage) / 1e9, getStageCpuNanoseconds(stage) / 1e9);
+            }
+
+            fmt::format_to(output, "{0:<10s} {1:>10.4f}\n\n", "total", totalSeconds);
+            fmt::format_to(
+                output,
+                "Read {0:d} lines ({1:s}) at {2:.0f} lines/s; {3:d} endlessh entries ({4:.2f}% of lines), {5:d} parsed\n"
+                "Unique hosts: {6:d}, peak RSS: {7:s}\n",
+                m_linesRead, getHumanReadableBytes(m_bytesRead), totalSeconds > 0 ? m_linesRead / totalSeconds : 0.0,
+                m_endlesshLines, getHitPercentage(), m_events, m_uniqueHosts, getHumanReadableBytes(getPeakResidentBytes())
+            );
+
+            return fmt::to_string(buffer);
+        }
+
+        /**
+         * @brief Formats the profile as a single-line JSON object, e.g. to append to a file and trend over time.
+         */
+        string formatJson() const {
+            fmt::memory_buffer buffer;
+            auto output = std::back_inserter(buffer);
+            const auto totalNanoseconds = getTotalWallNanoseconds();
+
+            fmt::format_to(output, R"({{"timestamp":"{0:s}","stages":{{)", getCurrentIsoTimestamp());
+
+            for (size_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+                const auto stage = static_cast<ProfileStage>(i);
+                fmt::format_to(
+                    output, R"({0:s}"{1:s}":{{"wallSeconds":{2:.6f},"cpuSeconds":{3:.6f}}})",
+                    i == 0 ? "" : ",", getProfileStageName(stage), getStageWallNanoseconds(stage) / 1e9, getStageCpuNanoseconds(stage) / 1e9
+                );
+            }
+
+            fmt::format_to(
+                output,
+                R"(}},"wallSeconds":{0:.6f},"linesRead":{1:d},"bytesRead":{2:d},"linesPerSecond":{3:.0f},"endlesshLines":{4:d},)"
+                R"("endlesshHitRatio":{5:.6f},"parsedEntries":{6:d},"uniqueHosts":{7:d},"peakRssBytes":{8:d},"readThreads":{9:d}}})",
+                totalNanoseconds / 1e9, m_linesRead, m_bytesRead, totalNanoseconds > 0 ? m_linesRead / (totalNanoseconds / 1e9) : 0.0,
+                m_endlesshLines, getHitPercentage() / 100, m_events, m_uniqueHosts, getPeakResidentBytes(), m_readThreads
+            );
+
+            return fmt::to_string(buffer);
+        }
+
+    private: // +++ Implementation +++
+        constexpr static size_t MERGE_INDEX = static_cast<size_t>(ProfileStage::Merge);
+
+        static uint64_t readClock(const clockid_t clock) {
+            struct timespec time{};
+            clock_gettime(clock, &time);
+            return static_cast<uint64_t>(time.tv_sec) * 1000000000 + static_cast<uint64_t>(time.tv_nsec);
+        }
+
+        static uint64_t subtractNested(const uint64_t total, const uint64_t nested) { return total > nested ? total - nested : 0; }
+
+        uint64_t getPerLineNanoseconds() const {
+            uint64_t total = 0;
+            for (const auto nanoseconds : m_perLineNanoseconds) { total += nanoseconds; }
+
+            return total;
+        }
+
+        double getHitPercentage() const { return m_linesRead == 0 ? 0.0 : m_endlesshLines * 100.0 / m_linesRead; }
+
+    private: // +++ Members +++
+        std::mutex                                  m_mutex; //!< Guards the measurements added by several threads
+        std::array<uint64_t, PROFILE_STAGE_COUNT>   m_stageWallNanoseconds{}; //!< The wall time of the stages timed as a whole
+        std::array<uint64_t, PROFILE_STAGE_COUNT>   m_stageCpuNanoseconds{}; //!< The CPU time of the stages timed as a whole
+        std::array<uint64_t, PROFILE_STAGE_COUNT>   m_perLineNanoseconds{}; //!< The time of the per-line stages, summed over all threads
+        uint64_t                                    m_bytesRead{0}; //!< The amount of (uncompressed) bytes read
+        uint64_t                                    m_linesRead{0}; //!< The amount of lines read
+        uint64_t                                    m_endlesshLines{0}; //!< The amount of lines containing the endlessh tag
+        uint64_t                                    m_events{0}; //!< The amount of entries tokenized successfully
+        uint64_t                                    m_uniqueHosts{0}; //!< The amount of unique hosts in the report
+        uint32_t                                    m_readThreads{1}; //!< The amount of threads the log was read on
+};
+
+inline void ProfileSample::addTime(const ProfileStage stage, const uint64_t start, const uint64_t end) {
+    const auto elapsed = end - start;
+    const auto overhead = Profiler::getClockOverhead();
+
+    stageNanoseconds[static_cast<size_t>(stage)] += elapsed > overhead ? elapsed - overhead : 0;
+}
+
+#endif // ENDLESSH_REPORT_INCLUDE_PROFILER_HPP
@@ -0,0 +1,97 @@
+/**
+ * @file ranking.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains the selection of the hosts ranking highest by a given statistic.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_RANKING_HPP
+#define ENDLESSH_REPORT_INCLUDE_RANKING_HPP
+
+// stl
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using std::string_view;
+using std::vector;
+
+/**
+ * @brief The statistics hosts can be ranked by.
+ */
+enum class RankingField: uint8_t {
+    None,       //!< Don't rank; keep the order of the table
+    Accepted,   //!< The amount of accepted connections
+    Closed,     //!< The amount of closed connections
+    Ports,      //!< The amount of distinct source ports (detailed only)
+    TimeWasted, //!< The total time wasted (detailed only)
+    BytesSent   //!< The total amount of bytes sent (detailed only)
+};
+
+/**
+ * @brief Parses the name of a ranking field, as given on the command line.
+ *
+ * @param name The name: accepted, closed, ports, time or bytes.
+ * @param field Will contain the field.
+ *
+ * @return true If the name is known.
+ * @return false Otherwise.
+ */
+inline bool parseRankingField(const string_view name, RankingField& field) {
+    if (name == "accepted") { field = RankingField::Accepted; }
+    else if (name == "closed") { field = RankingField::Closed; }
+    else if (name == "ports") { field = RankingField::Ports; }
+    else if (name == "time") { field = RankingField::TimeWasted; }
+    else if (name == "bytes") { field = RankingField::BytesSent; }
+    else { return false; }
+
+    return true;
+}
+
+/**
+ * @brief Selects the entries of a collection with the highest keys, highest first.
+ *
+ * Only the selected entries are ordered (@see std::partial_sort), so selecting the top k of n entries takes O(n log k).
+ * Entries with equal keys keep the order they have in the collection.
+ *
+ * @param collection The collection to select from.
+ * @param maxEntries The maximum amount of entries to select.
+ * @param getKey A callable returning the (unsigned integer) key of an entry.
+ *
+ * @return vector<const Entry*> Pointers to the selected entries.
+ */
+template<typename Collection, typename KeyFunction>
+auto selectTopEntries(const Collection& collection, const size_t maxEntries, KeyFunction&& getKey) {
+    using Entry = std::remove_reference_t<decltype(*std::begin(collection))>;
+
+    vector<Entry*> entries;
+    vector<std::pair<uint64_t, uint32_t>> keys; // (key, index in entries); compact, so ordering stays cache-friendly
+
+    for (auto& entry : collection) {
+        keys.emplace_back(getKey(entry), static_cast<uint32_t>(entries.size()));
+        entries.push_back(&entry);
+    }
+
+    const auto selectedCount = std::min(maxEntries, keys.size());
+    std::partial_sort(keys.begin(), keys.begin() + selectedCount, keys.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+
+    vector<Entry*> selectedEntries;
+    selectedEntries.reserve(selectedCount);
+
+    for (size_t i = 0; i < selectedCount; i++) {
+        selectedEntries.push_back(entries[keys[i].second]);
+    }
+
+    return selectedEntries;
+}
+
+#endif // ENDLESSH_REPORT_INCLUDE_RANKING_HPP
@@ -0,0 +1,335 @@
+/**
+ * @file reportedindex.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains the index of hosts already reported to AbuseIPDB, used to leave them out of reports until they've cooled down.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_REPORTEDINDEX_HPP
+#define ENDLESSH_REPORT_INCLUDE_REPORTEDINDEX_HPP
+
+#include "ipaddress.hpp"
+
+// stl
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// libc
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string;
+using std::string_view;
+
+constexpr string_view   REPORTED_INDEX_MAGIC = "ERGRPIDX"; //!< Identifies a reported-host index
+constexpr uint8_t       REPORTED_INDEX_VERSION = 1; //!< The current version of the reported-host index format
+
+/**
+ * @brief A persistent index of the hosts reported to AbuseIPDB and when they were last reported.
+ *
+ * The index is an open-addressing hash table (linear probing) laid out directly in the file, which is mapped into
+ * memory: looking up or updating a host touches a slot or two of the mapping, however large the index grows. Updates
+ * are written to the mapping in place; the kernel writes them back. The file is locked for as long as it's open, so
+ * concurrent runs take turns.
+ *
+ * Hosts last reported a full cooldown ago are as good as unreported, so they're dropped whenever the table is rebuilt:
+ * when it fills up, or when it's opened and most of its entries have cooled down. Rebuilding writes a new file and
+ * renames it over the old one. The index therefore only ever holds about as many hosts as are reported per cooldown.
+ *
+ * The file is stored in native byte order and isn't meant to be moved between machines.
+ */
+class ReportedHostIndex {
+    public: // +++ Constants +++
+        constexpr static uint64_t MIN_SLOT_COUNT = 1024; //!< The minimum amount of slots; must be a power of two
+
+    public: // +++ Constructor / Destructor +++
+        ReportedHostIndex() = default;
+        ReportedHostIndex(const ReportedHostIndex&) = delete;
+        ReportedHostIndex& operator=(const ReportedHostIndex&) = delete;
+        ~ReportedHostIndex() { close(); }
+
+    public: // +++ Opening / Closing +++
+        /**
+         * @brief Opens (or creates) the index and locks it.
+         *
+         * @param path The path of the index file.
+         * @param cooldownSeconds The time after which a reported host may be reported again.
+         * @param now The current time, in seconds since the epoch; entries which have cooled down by then may be dropped.
+         *
+         * @return true If the index was opened successfully.
+         * @return false Otherwise; errno describes the error (EINVAL: the file isn't a valid index).
+         */
+        bool open(const string& path, const int64_t cooldownSeconds, const int64_t now) {
+            close();
+            m_path = path;
+            m_cooldownSeconds = cooldownSeconds;
+
+            if (!openLocked()) { return false; }
+
+            struct stat fileInfo{};
+            if (fstat(m_fd, &fileInfo) != 0) { return fail(); }
+
+            // A new (empty) index is created in place; it's locked, so nobody else can be initialising it, too
+            if (fileInfo.st_size == 0) {
+                if (ftruncate(m_fd, static_cast<off_t>(getFileSize(MIN_SLOT_COUNT))) != 0 || !map(MIN_SLOT_COUNT)) { return fail(); }
+
+                memcpy(m_header->magic, REPORTED_INDEX_MAGIC.data(), REPORTED_INDEX_MAGIC.size());
+                m_header->version = REPORTED_INDEX_VERSION;
+                m_header->slotCount = MIN_SLOT_COUNT;
+                return true;
+            }
+
+            Header header{};
+            if (pread(m_fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))
+                || string_view(header.magic, sizeof(header.magic)) != REPORTED_INDEX_MAGIC
+                || header.version != REPORTED_INDEX_VERSION
+                || header.slotCount < MIN_SLOT_COUNT || (header.slotCount & (header.slotCount - 1)) != 0
+                || static_cast<uint64_t>(fileInfo.st_size) != getFileSize(header.slotCount)) {
+                errno = EINVAL;
+                return fail();
+            }
+
+            if (!map(header.slotCount)) { return fail(); }
+
+            // Compact once most of the index has cooled down
+            uint64_t activeEntries = 0;
+            for (uint64_t i = 0; i < m_header->slotCount; i++) {
+                activeEntries += m_slots[i].lastReported != 0 && !hasCooledDown(m_slots[i], now) ? 1 : 0;
+            }
+
+            if (m_header->entryCount > MIN_SLOT_COUNT / 2 && activeEntries < m_header->entryCount / 2) {
+                return rebuild(getSlotCountFor(activeEntries), now);
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Writes the index back to disk, unlocks and closes it.
+         *
+         * @return true If the index was never opened, or all updates made to it were written successfully.
+         * @return false Otherwise.
+         */
+        bool close() {
+            auto success = !m_hasFailed;
+
+            if (m_header != nullptr) {
+                success = msync(m_header, m_mappingSize, MS_SYNC) == 0 && success;
+                munmap(m_header, m_mappingSize);
+                m_header = nullptr;
+                m_slots = nullptr;
+            }
+
+            if (m_fd >= 0) {
+                ::close(m_fd); // Releases the lock
+                m_fd = -1;
+            }
+
+            m_hasFailed = false;
+            return success;
+        }
+
+    public: // +++ Lookup / Modification +++
+        bool isOpen() const { return m_header != nullptr; }
+
+        /**
+         * @brief Checks whether a host is due to be reported: it was never reported, or its last report has cooled down.
+         */
+        bool isDue(const IpAddress& host, const int64_t now) const {
+            if (m_header == nullptr) { return true; }
+
+            const auto& slot = m_slots[findSlot(host)];
+
+            return slot.lastReported == 0 || hasCooledDown(slot, now);
+        }
+
+        /**
+         * @brief Records that a host was reported.
+         *
+         * @return true If the host was recorded.
+         * @return false If the index had to grow and couldn't be rebuilt; it can't be used any further.
+         */
+        bool markReported(const IpAddress& host, const int64_t now) {
+            if (m_header == nullptr) { return false; }
+
+            auto* slot = &m_slots[findSlot(host)];
+
+            if (slot->lastReported == 0) {
+                // Keep the load below 3/4 so probe sequences stay short
+                if ((m_header->entryCount + 1) * 4 > m_header->slotCount * 3) {
+                    if (!rebuild(m_header->slotCount * 2, now)) { return false; }
+                    slot = &m_slots[findSlot(host)];
+                }
+
+                // The address is stored first; a slot without a time is still empty if the process dies in between
+                slot->high = host.high;
+                slot->low = host.low;
+                m_header->entryCount++;
+            }
+
+            slot->lastReported = now;
+            return true;
+        }
+
+        uint64_t getEntryCount() const { return m_header == nullptr ? 0 : m_header->entryCount; }
+
+    private: // +++ Types +++
+        struct Header {
+            char        magic[8]; //!< REPORTED_INDEX_MAGIC
+            uint8_t     version; //!< REPORTED_INDEX_VERSION
+            uint8_t     reserved[7]; //!< Padding; zero
+            uint64_t    slotCount; //!< The amount of slots following the header; a power of two
+            uint64_t    entryCount; //!< The amount of slots in use
+        };
+
+        struct Slot {
+            uint64_t    high; //!< The upper 64 bits of the host's address
+            uint64_t    low; //!< The lower 64 bits of the host's address
+            int64_t     lastReported; //!< When the host was last reported, in seconds since the epoch; 0 if the slot is empty
+        };
+
+    private: // +++ Implementation +++
+        static uint64_t getFileSize(const uint64_t slotCount) { return sizeof(Header) + slotCount * sizeof(Slot); }
+
+        static uint64_t getSlotCountFor(const uint64_t entryCount) {
+            uint64_t slotCount = MIN_SLOT_COUNT;
+            while (entryCount * 2 > slotCount) { slotCount *= 2; }
+
+            return slotCount;
+        }
+
+        bool hasCooledDown(const Slot& slot, const int64_t now) const { return now - slot.lastReported >= m_cooldownSeconds; }
+
+        /**
+         * @brief Finds the slot holding a host, or the empty slot it would be inserted into.
+         */
+        uint64_t findSlot(const IpAddress& host) const {
+            const auto mask = m_header->slotCount - 1;
+            auto index = host.hash() & mask;
+
+            while (m_slots[index].lastReported != 0 && (m_slots[index].high != host.high || m_slots[index].low != host.low)) {
+                index = (index + 1) & mask;
+            }
+
+            return index;
+        }
+
+        /**
+         * @brief Opens and locks the file at m_path, making sure it wasn't replaced by a rebuild while waiting for the lock.
+         */
+        bool openLocked() {
+            while (true) {
+                m_fd = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+                if (m_fd < 0 || flock(m_fd, LOCK_EX) != 0) { return fail(); }
+
+                struct stat lockedInfo{};
+                struct stat currentInfo{};
+                if (fstat(m_fd, &lockedInfo) != 0) { return fail(); }
+
+                if (stat(m_path.c_str(), &currentInfo) == 0 && currentInfo.st_dev == lockedInfo.st_dev && currentInfo.st_ino == lockedInfo.st_ino) {
+                    return true;
+                }
+
+                ::close(m_fd);
+                m_fd = -1;
+            }
+        }
+
+        bool map(const uint64_t slotCount) {
+            m_mappingSize = static_cast<size_t>(getFileSize(slotCount));
+            auto* mapping = mmap(nullptr, m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+            if (mapping == MAP_FAILED) { return false; }
+
+            m_header = static_cast<Header*>(mapping);
+            m_slots = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + sizeof(Header));
+            return true;
+        }
+
+        /**
+         * @brief Writes the entries which haven't cooled down yet to a new file of the given amount of slots and replaces the index with it.
+         */
+        bool rebuild(const uint64_t slotCount, const int64_t now) {
+            const auto tmpPath = m_path + ".tmp";
+            const auto fd = ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) { return fail(); }
+
+            // Lock the new file before it's visible, so waiting runs can't slip in between the rename and closing the old one
+            if (flock(fd, LOCK_EX) != 0 || ftruncate(fd, static_cast<off_t>(getFileSize(slotCount))) != 0) {
+                ::close(fd);
+                unlink(tmpPath.c_str());
+                return fail();
+            }
+
+            auto* oldHeader = m_header;
+            auto* oldSlots = m_slots;
+            const auto oldMappingSize = m_mappingSize;
+            const auto oldFd = m_fd;
+
+            m_fd = fd;
+            if (!map(slotCount)) {
+                m_fd = oldFd;
+                m_mappingSize = oldMappingSize;
+                ::close(fd);
+                unlink(tmpPath.c_str());
+                return fail();
+            }
+
+            memcpy(m_header->magic, REPORTED_INDEX_MAGIC.data(), REPORTED_INDEX_MAGIC.size());
+            m_header->version = REPORTED_INDEX_VERSION;
+            m_header->slotCount = slotCount;
+
+            for (uint64_t i = 0; i < oldHeader->slotCount; i++) {
+                const auto& slot = oldSlots[i];
+                if (slot.lastReported == 0 || hasCooledDown(slot, now)) { continue; }
+
+                IpAddress host;
+                host.high = slot.high;
+                host.low = slot.low;
+                m_slots[findSlot(host)] = slot;
+                m_header->entryCount++;
+            }
+
+            const auto isWritten = msync(m_header, m_mappingSize, MS_SYNC) == 0 && std::rename(tmpPath.c_str(), m_path.c_str()) == 0;
+
+            munmap(oldHeader, oldMappingSize);
+            ::close(oldFd);
+
+            if (!isWritten) {
+                unlink(tmpPath.c_str());
+                return fail();
+            }
+
+            return true;
+        }
+
+        bool fail() {
+            const auto error = errno;
+
+            close();
+            m_hasFailed = true;
+
+            errno = error;
+            return false;
+        }
+
+    private: // +++ Members +++
+        string      m_path; //!< The path of the index file
+        int32_t     m_fd{-1}; //!< The open, locked index file
+        Header*     m_header{nullptr}; //!< The mapped index file
+        Slot*       m_slots{nullptr}; //!< The slots following the header
+        size_t      m_mappingSize{0}; //!< The size of the mapping
+        int64_t     m_cooldownSeconds{0}; //!< The time after which a reported host may be reported again
+        bool        m_hasFailed{false}; //!< Whether an update couldn't be written
+};
+
+#endif // ENDLESSH_REPORT_INCLUDE_REPORTEDINDEX_HPP
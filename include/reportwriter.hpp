@@ -0,0 +1,132 @@
+/**
+ * @file reportwriter.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains a buffered writer used to format the reports.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_REPORTWRITER_HPP
+#define ENDLESSH_REPORT_INCLUDE_REPORTWRITER_HPP
+
+// stl
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+// fmt
+#include <fmt/format.h>
+
+using std::string_view;
+
+/**
+ * @brief Formats a report into a single growable buffer and writes it out in large blocks.
+ *
+ * Rows are never flushed individually; the buffer is only written once it grows past @see FLUSH_THRESHOLD,
+ * or when @see flush is called (at the latest on destruction).
+ * The buffer is written to a stdio stream, so output written through cout/stdout before or after stays in order.
+ */
+class ReportWriter {
+    public: // +++ Constants +++
+        constexpr static size_t FLUSH_THRESHOLD = 1024 * 1024; //!< The size the buffer may grow to before it's written out
+
+    public: // +++ Constructor / Destructor +++
+        explicit ReportWriter(FILE* stream = stdout): m_stream(stream) {}
+        ReportWriter(const ReportWriter&) = delete;
+        ReportWriter& operator=(const ReportWriter&) = delete;
+        ~ReportWriter() { flush(); }
+
+    public: // +++ Writing +++
+        ReportWriter& write(const string_view str) {
+            m_buffer.append(str.data(), str.data() + str.size());
+            return *this;
+        }
+
+        ReportWriter& write(const char c) {
+            m_buffer.push_back(c);
+            return *this;
+        }
+
+        /**
+         * @brief Writes a string centred in a table cell of the given width.
+         *
+         * The left padding is half the cell's width less half the string's; strings wider than the cell are written as-is.
+         * The string is centred by its width on screen, so multi-byte UTF-8 characters (e.g. ±) count once.
+         *
+         * @param str The string to write.
+         * @param width The width of the cell.
+         */
+        ReportWriter& writeCentred(const string_view str, const uint32_t width) {
+            const auto displayWidth = getDisplayWidth(str);
+            if (displayWidth >= width) { return write(str); }
+
+            const auto leftPadding = width / 2 - displayWidth / 2;
+            appendPadding(leftPadding);
+            write(str);
+            appendPadding(width - displayWidth - leftPadding);
+
+            return *this;
+        }
+
+        /**
+         * @brief Writes a number centred in a table cell of the given width. @see writeCentred
+         */
+        ReportWriter& writeCentred(const uint64_t value, const uint32_t width) {
+            const fmt::format_int formatted(value);
+            return writeCentred(string_view(formatted.data(), formatted.size()), width);
+        }
+
+        /**
+         * @brief Gets the width of a UTF-8 string on screen, i.e. the amount of characters, not bytes.
+         */
+        static size_t getDisplayWidth(const string_view str) {
+            // Continuation bytes (10xxxxxx) don't start a character of their own
+            return static_cast<size_t>(std::count_if(str.begin(), str.end(), [](const char c) { return (static_cast<uint8_t>(c) & 0xc0) != 0x80; }));
+        }
+
+        /**
+         * @brief Ends the current line, writing the buffer out if it has grown large enough.
+         */
+        ReportWriter& endLine() {
+            m_buffer.push_back('\n');
+            if (m_buffer.size() >= FLUSH_THRESHOLD) { flush(); }
+
+            return *this;
+        }
+
+        /**
+         * @brief Writes the buffer to the stream and clears it.
+         *
+         * @return true If the buffer, and everything flushed before it, was written in its entirety.
+         * @return false Otherwise, including if the buffer couldn't be written when it was flushed by @see endLine. @see getErrorNumber
+         */
+        bool flush() {
+            const auto bytesWritten = std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_stream);
+            const auto isComplete = bytesWritten == m_buffer.size() && std::fflush(m_stream) == 0;
+
+            if (!isComplete && m_errorNumber == 0) { m_errorNumber = errno == 0 ? EIO : errno; }
+
+            m_buffer.clear();
+            return m_errorNumber == 0;
+        }
+
+        int getErrorNumber() const { return m_errorNumber; } //!< The errno of the first failed write, or 0
+
+    private: // +++ Implementation +++
+        void appendPadding(const size_t count) {
+            const auto offset = m_buffer.size();
+            m_buffer.resize(offset + count);
+            std::fill_n(m_buffer.data() + offset, count, ' ');
+        }
+
+    private: // +++ Members +++
+        FILE*               m_stream; //!< The stream the report is written to
+        fmt::memory_buffer  m_buffer; //!< The formatted, not yet written part of the report
+        int                 m_errorNumber{0}; //!< The errno of the first failed write, or 0
+};
+
+#endif // ENDLESSH_REPORT_INCLUDE_REPORTWRITER_HPP
@@ -0,0 +1,216 @@
+/**
+ * @file serialization.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains a minimal, endian-independent binary writer and reader used for persisting state.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_SERIALIZATION_HPP
+#define ENDLESSH_REPORT_INCLUDE_SERIALIZATION_HPP
+
+// stl
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+// libc
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @brief Serializes values into a growable byte buffer.
+ *
+ * Integers are written as unsigned LEB128 varints, so small counters (the common case) take one or two bytes
+ * and the format doesn't depend on the byte order of the machine that wrote it.
+ */
+class BinaryWriter {
+    public: // +++ Writing +++
+        void writeByte(const uint8_t value) { m_buffer.push_back(value); }
+
+        void writeVarInt(uint64_t value) {
+            while (value >= 0x80) {
+                m_buffer.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            m_buffer.push_back(static_cast<uint8_t>(value));
+        }
+
+        /**
+         * @brief Writes a 64-bit value as 8 big-endian bytes; used where values are not expected to be small.
+         */
+        void writeFixed64(const uint64_t value) {
+            for (int32_t shift = 56; shift >= 0; shift -= 8) {
+                m_buffer.push_back(static_cast<uint8_t>(value >> shift));
+            }
+        }
+
+        void writeBytes(const string_view bytes) { m_buffer.insert(m_buffer.end(), bytes.begin(), bytes.end()); }
+
+    public: // +++ Output +++
+        /**
+         * @brief Writes the buffer to a file, atomically replacing any previous version of it.
+         *
+         * The data is written to path.tmp and synced to disk before that's renamed, so a full disk or a crash
+         * leaves the previous version in place instead of a truncated one. The directory is synced after the rename,
+         * so the new version survives a crash once this returns.
+         *
+         * @param path The path to write to.
+         *
+         * @return true If the file was written successfully.
+         * @return false Otherwise; the previous version is left untouched and path.tmp is removed. If only syncing the
+         *         directory failed, the new version is in place, but may be lost on a crash.
+         */
+        bool writeToFile(const string& path) const {
+            const auto tmpPath = path + ".tmp";
+            const auto fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) { return false; }
+
+            auto isWritten = true;
+            for (size_t offset = 0; isWritten && offset < m_buffer.size();) {
+                const auto bytesWritten = write(fd, m_buffer.data() + offset, m_buffer.size() - offset);
+
+                if (bytesWritten > 0) {
+                    offset += static_cast<size_t>(bytesWritten);
+                } else if (bytesWritten < 0 && errno == EINTR) {
+                    continue;
+                } else {
+                    isWritten = false;
+                }
+            }
+
+            isWritten = isWritten && fsync(fd) == 0;
+            isWritten = close(fd) == 0 && isWritten;
+
+            if (!isWritten || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+                unlink(tmpPath.c_str());
+                return false;
+            }
+
+            return syncDirectoryOf(path);
+        }
+
+    private: // +++ Implementation +++
+        /**
+         * @brief Syncs the directory holding the given path to disk; a rename is only durable once its directory is.
+         */
+        static bool syncDirectoryOf(const string& path) {
+            const auto separator = path.find_last_of('/');
+            const auto directory = separator == string::npos ? string(".") : path.substr(0, std::max<size_t>(separator, 1));
+
+            const auto fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0) { return false; }
+
+            const auto isSynced = fsync(fd) == 0;
+            return close(fd) == 0 && isSynced;
+        }
+
+    private: // +++ Members +++
+        vector<uint8_t> m_buffer; //!< The serialized data
+};
+
+/**
+ * @brief Deserializes values written by a @see BinaryWriter.
+ *
+ * Reading past the end of the data doesn't throw; instead the reader is marked as failed and returns zeroes,
+ * so callers only need to check @see isGood once they're done.
+ */
+class BinaryReader {
+    public: // +++ Constructor / Destructor +++
+        BinaryReader() = default;
+        explicit BinaryReader(vector<uint8_t> data): m_data(std::move(data)) {}
+
+    public: // +++ Input +++
+        /**
+         * @brief Reads an entire file into the reader.
+         *
+         * @param path The path of the file to read.
+         *
+         * @return true If the file was read successfully.
+         * @return false Otherwise.
+         */
+        bool readFromFile(const string& path) {
+            std::ifstream fileStream(path, std::ios::binary);
+            if (!fileStream.good()) { return false; }
+
+            m_data.assign(std::istreambuf_iterator<char>(fileStream), std::istreambuf_iterator<char>());
+            m_position = 0;
+            m_good = !fileStream.bad();
+
+            return m_good;
+        }
+
+    public: // +++ Reading +++
+        uint8_t readByte() {
+            if (!ensureAvailable(1)) { return 0; }
+            return m_data[m_position++];
+        }
+
+        uint64_t readVarInt() {
+            uint64_t value = 0;
+
+            for (uint32_t shift = 0; shift < 64; shift += 7) {
+                const auto byte = readByte();
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+                if ((byte & 0x80) == 0) { return value; }
+            }
+
+            m_good = false;
+            return 0;
+        }
+
+        uint64_t readFixed64() {
+            if (!ensureAvailable(8)) { return 0; }
+
+            uint64_t value = 0;
+            for (uint32_t i = 0; i < 8; i++) {
+                value = (value << 8) | m_data[m_position++];
+            }
+
+            return value;
+        }
+
+        string_view readBytes(const size_t length) {
+            if (!ensureAvailable(length)) { return {}; }
+
+            const string_view bytes(reinterpret_cast<const char*>(m_data.data()) + m_position, length);
+            m_position += length;
+
+            return bytes;
+        }
+
+    public: // +++ State +++
+        bool isGood() const { return m_good; }
+        bool isAtEnd() const { return m_position >= m_data.size(); }
+
+    private: // +++ Implementation +++
+        bool ensureAvailable(const size_t length) {
+            if (!m_good || m_data.size() - m_position < length) {
+                m_good = false;
+                return false;
+            }
+
+            return true;
+        }
+
+    private: // +++ Members +++
+        vector<uint8_t> m_data; //!< The data being read
+        size_t          m_position{0}; //!< The current read position
+        bool            m_good{true}; //!< Whether all reads so far succeeded
+};
+
+#endif // ENDLESSH_REPORT_INCLUDE_SERIALIZATION_HPP
@@ -0,0 +1,338 @@
+/**
+ * @file sketch.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains fixed-size probabilistic summaries of the hosts, for when counting each of them exactly takes too much memory.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_SKETCH_HPP
+#define ENDLESSH_REPORT_INCLUDE_SKETCH_HPP
+
+#include "ipaddress.hpp"
+
+// stl
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using std::pair;
+using std::unordered_map;
+using std::vector;
+
+/**
+ * @brief Estimates the amount of distinct items added to it, in a fixed 16 KiB.
+ *
+ * Each item's hash selects a register by its upper PRECISION bits; the register keeps the highest position of the first
+ * set bit seen in the remaining bits. @see estimate combines the registers using a harmonic mean (Flajolet et al.),
+ * with linear counting for small cardinalities. The hashes must be well-mixed 64-bit values.
+ */
+class HyperLogLog {
+    public: // +++ Constants +++
+        constexpr static uint32_t PRECISION = 14; //!< The amount of hash bits selecting a register
+        constexpr static uint32_t REGISTER_COUNT = 1u << PRECISION; //!< The amount of registers
+
+    public: // +++ Constructor / Destructor +++
+        HyperLogLog(): m_registers(REGISTER_COUNT, 0) {}
+
+    public: // +++ Modification +++
+        void add(const uint64_t hash) {
+            const auto index = hash >> (64 - PRECISION);
+            // The sentinel bit bounds the rank for hashes whose remaining bits are all zero
+            const auto rank = static_cast<uint8_t>(__builtin_clzll((hash << PRECISION) | (uint64_t(1) << (PRECISION - 1))) + 1);
+
+            m_registers[index] = std::max(m_registers[index], rank);
+        }
+
+        /**
+         * @brief Adds the items of another estimator; the result is the same as if they had all been added to this one.
+         */
+        void merge(const HyperLogLog& other) {
+            for (uint32_t i = 0; i < REGISTER_COUNT; i++) {
+                m_registers[i] = std::max(m_registers[i], other.m_registers[i]);
+            }
+        }
+
+    public: // +++ Results +++
+        /**
+         * @brief Estimates the amount of distinct items added.
+         */
+        double estimate() const {
+            constexpr double m = REGISTER_COUNT;
+            const double alpha = 0.7213 / (1.0 + 1.079 / m);
+
+            double sum = 0;
+            uint32_t emptyRegisters = 0;
+
+            for (const auto rank : m_registers) {
+                sum += std::ldexp(1.0, -rank);
+                emptyRegisters += rank == 0 ? 1 : 0;
+            }
+
+            const auto estimate = alpha * m * m / sum;
+
+            // Few items leave many registers empty, for which counting them is more accurate
+            if (estimate <= 2.5 * m && emptyRegisters > 0) {
+                return m * std::log(m / emptyRegisters);
+            }
+
+            return estimate;
+        }
+
+        /**
+         * @brief Gets the relative standard error of the estimate: 1.04 / sqrt(REGISTER_COUNT), i.e. 0.81%.
+         */
+        static double getRelativeError() { return 1.04 / std::sqrt(static_cast<double>(REGISTER_COUNT)); }
+
+    private: // +++ Members +++
+        vector<uint8_t> m_registers; //!< The highest rank seen per register
+};
+
+/**
+ * @brief Counts how often each item is added to it, in a fixed amount of memory (@see WIDTH, @see DEPTH).
+ *
+ * Each item is counted in one counter per row, chosen by a hash per row; its count is estimated by the smallest of them.
+ * Estimates are never too low. With probability 1 - e^-DEPTH, they're too high by at most e / WIDTH times the total
+ * of all counts (Cormode and Muthukrishnan); @see getErrorBound.
+ */
+class CountMinSketch {
+    public: // +++ Constants +++
+        constexpr static uint32_t WIDTH = 1u << 16; //!< The amount of counters per row; a power of two
+        constexpr static uint32_t DEPTH = 5; //!< The amount of rows
+
+    public: // +++ Constructor / Destructor +++
+        CountMinSketch(): m_counters(size_t(WIDTH) * DEPTH, 0) {}
+
+    public: // +++ Modification +++
+        /**
+         * @brief Adds to the count of an item.
+         *
+         * @param hash The well-mixed 64-bit hash of the item.
+         * @param count The amount to add.
+         */
+        void add(const uint64_t hash, const uint32_t count = 1) {
+            for (uint32_t row = 0; row < DEPTH; row++) {
+                auto& counter = m_counters[size_t(row) * WIDTH + getColumn(hash, row)];
+                counter = counter > UINT32_MAX - count ? UINT32_MAX : counter + count;
+            }
+
+            m_totalCount += count;
+        }
+
+        /**
+         * @brief Adds the counts of another sketch; the result is the same as if they had all been added to this one.
+         */
+        void merge(const CountMinSketch& other) {
+            for (size_t i = 0; i < m_counters.size(); i++) {
+                m_counters[i] = static_cast<uint32_t>(std::min<uint64_t>(uint64_t(m_counters[i]) + other.m_counters[i], UINT32_MAX));
+            }
+
+            m_totalCount += other.m_totalCount;
+        }
+
+    public: // +++ Results +++
+        /**
+         * @brief Estimates the count of an item. @see getErrorBound
+         */
+        uint64_t estimate(const uint64_t hash) const {
+            uint32_t count = UINT32_MAX;
+
+            for (uint32_t row = 0; row < DEPTH; row++) {
+                count = std::min(count, m_counters[size_t(row) * WIDTH + getColumn(hash, row)]);
+            }
+
+            return count;
+        }
+
+        /**
+         * @brief Gets the amount by which an estimate may be too high, with the probability given by @see getConfidence.
+         */
+        uint64_t getErrorBound() const { return static_cast<uint64_t>(std::ceil(M_E / WIDTH * m_totalCount)); }
+
+        static double getConfidence() { return 1.0 - std::exp(-static_cast<double>(DEPTH)); }
+
+    private: // +++ Implementation +++
+        /**
+         * @brief Derives the column of an item in a row from two halves of its hash (Kirsch and Mitzenmacher).
+         */
+        static uint32_t getColumn(const uint64_t hash, const uint32_t row) {
+            const auto first = static_cast<uint32_t>(hash);
+            const auto second = static_cast<uint32_t>(hash >> 32) | 1;
+
+            return (first + row * second) & (WIDTH - 1);
+        }
+
+    private: // +++ Members +++
+        vector<uint32_t>    m_counters; //!< DEPTH rows of WIDTH counters
+        uint64_t            m_totalCount{0}; //!< The total of all counts
+};
+
+/**
+ * @brief Keeps the hosts with the highest counts, out of a stream of hosts and their current counts.
+ *
+ * The hosts are kept in a min-heap of at most the given capacity, so the host with the lowest count can be replaced in
+ * O(log n) once a host with a higher count comes along. A host's position in the heap is indexed, so its count can be
+ * updated in place.
+ */
+class HeavyHitters {
+    public: // +++ Constructor / Destructor +++
+        explicit HeavyHitters(const size_t capacity): m_capacity(capacity) {
+            m_heap.reserve(capacity);
+            m_positions.reserve(capacity);
+        }
+
+    public: // +++ Modification +++
+        /**
+         * @brief Offers a host and its current count.
+         *
+         * @param host The host.
+         * @param count The host's count; never lower than a count offered for it before.
+         */
+        void offer(const IpAddress& host, const uint64_t count) {
+            const auto position = m_positions.find(host);
+
+            if (position != m_positions.end()) {
+                m_heap[position->second].second = count;
+                siftDown(position->second);
+            } else if (m_heap.size() < m_capacity) {
+                m_heap.emplace_back(host, count);
+                m_positions.emplace(host, m_heap.size() - 1);
+                siftUp(m_heap.size() - 1);
+            } else if (m_capacity > 0 && count > m_heap.front().second) {
+                m_positions.erase(m_heap.front().first);
+                m_heap.front() = { host, count };
+                m_positions.emplace(host, 0);
+                siftDown(0);
+            }
+        }
+
+        void clear() {
+            m_heap.clear();
+            m_positions.clear();
+        }
+
+    public: // +++ Results +++
+        /**
+         * @brief Gets the hosts and their counts, highest count first.
+         */
+        vector<pair<IpAddress, uint64_t>> getSorted() const {
+            auto hosts = m_heap;
+            std::sort(hosts.begin(), hosts.end(), [](const auto& a, const auto& b) {
+                return a.second != b.second ? a.second > b.second : a.first < b.first;
+            });
+
+            return hosts;
+        }
+
+    private: // +++ Implementation +++
+        void swapEntries(const size_t a, const size_t b) {
+            std::swap(m_heap[a], m_heap[b]);
+            m_positions[m_heap[a].first] = a;
+            m_positions[m_heap[b].first] = b;
+        }
+
+        void siftUp(size_t index) {
+            while (index > 0) {
+                const auto parent = (index - 1) / 2;
+                if (m_heap[parent].second <= m_heap[index].second) { break; }
+
+                swapEntries(parent, index);
+                index = parent;
+            }
+        }
+
+        void siftDown(size_t index) {
+            while (true) {
+                const auto left = index * 2 + 1;
+                const auto right = left + 1;
+                auto smallest = index;
+
+                if (left < m_heap.size() && m_heap[left].second < m_heap[smallest].second) { smallest = left; }
+                if (right < m_heap.size() && m_heap[right].second < m_heap[smallest].second) { smallest = right; }
+                if (smallest == index) { break; }
+
+                swapEntries(smallest, index);
+                index = smallest;
+            }
+        }
+
+    private: // +++ Members +++
+        size_t                              m_capacity; //!< The maximum amount of hosts kept
+        vector<pair<IpAddress, uint64_t>>   m_heap; //!< The hosts and their counts; a min-heap by count
+        unordered_map<IpAddress, size_t>    m_positions; //!< The position of each host in the heap
+};
+
+/**
+ * @brief Summarises the hosts in a fixed amount of memory (about 1.3 MiB), regardless of how many there are.
+ *
+ * The amount of unique hosts is estimated with a @see HyperLogLog. The accepted connections per host are counted in
+ * a @see CountMinSketch, whose estimates are fed to a @see HeavyHitters to find the hosts with the most connections.
+ */
+class ApproximateHostStatistics {
+    public: // +++ Constants +++
+        constexpr static size_t HEAVY_HITTER_CAPACITY = 1024; //!< The amount of hosts with the most connections which are kept
+
+    public: // +++ Constructor / Destructor +++
+        ApproximateHostStatistics(): m_topHosts(HEAVY_HITTER_CAPACITY) {}
+
+    public: // +++ Modification +++
+        void addAccept(const IpAddress& host) {
+            const auto hash = host.hash();
+
+            m_uniqueHosts.add(hash);
+            m_acceptedConnections.add(hash);
+            m_topHosts.offer(host, m_acceptedConnections.estimate(hash));
+        }
+
+        /**
+         * @brief Adds a closed connection. Hosts only seen closing connections (e.g. accepted before the log started) count as unique hosts, too.
+         */
+        void addClose(const IpAddress& host) { m_uniqueHosts.add(host.hash()); }
+
+        /**
+         * @brief Merges the statistics of another part of the log into these.
+         *
+         * The counts of the candidates of both parts are re-estimated from the merged sketch, so a host which only made
+         * the top of one part can't push out one with more connections in total.
+         */
+        void merge(const ApproximateHostStatistics& other) {
+            m_uniqueHosts.merge(other.m_uniqueHosts);
+            m_acceptedConnections.merge(other.m_acceptedConnections);
+
+            auto candidates = m_topHosts.getSorted();
+            const auto otherCandidates = other.m_topHosts.getSorted();
+            candidates.insert(candidates.end(), otherCandidates.begin(), otherCandidates.end());
+
+            m_topHosts.clear();
+            for (const auto& candidate : candidates) {
+                m_topHosts.offer(candidate.first, m_acceptedConnections.estimate(candidate.first.hash()));
+            }
+        }
+
+    public: // +++ Results +++
+        uint64_t getUniqueHosts() const { return static_cast<uint64_t>(std::llround(m_uniqueHosts.estimate())); }
+
+        /**
+         * @brief Gets the margin of error of @see getUniqueHosts, at about 95% confidence (two standard errors).
+         */
+        uint64_t getUniqueHostsError() const { return static_cast<uint64_t>(std::ceil(2 * HyperLogLog::getRelativeError() * m_uniqueHosts.estimate())); }
+
+        /**
+         * @brief Gets the hosts with the most accepted connections, most first, along with their estimated connections.
+         */
+        vector<pair<IpAddress, uint64_t>> getTopHosts() const { return m_topHosts.getSorted(); }
+
+        const CountMinSketch& getAcceptedConnections() const { return m_acceptedConnections; } //!< The accepted connections per host
+
+    private: // +++ Members +++
+        HyperLogLog     m_uniqueHosts; //!< Estimates the amount of unique hosts
+        CountMinSketch  m_acceptedConnections; //!< Estimates the accepted connections per host
+        HeavyHitters    m_topHosts; //!< The hosts with the most accepted connections
+};
+
+#endif // ENDLESSH_REPORT_INCLUDE_SKETCH_HPP
@@ -0,0 +1,71 @@
+/**
+ * @file snapshot.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains the snapshot file used to export the aggregates of one host and merge them with those of others.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_SNAPSHOT_HPP
+#define ENDLESSH_REPORT_INCLUDE_SNAPSHOT_HPP
+
+#include "aggregator.hpp"
+#include "serialization.hpp"
+
+// stl
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using std::string;
+using std::string_view;
+
+constexpr string_view   SNAPSHOT_FILE_MAGIC = "ERGSNAPS"; //!< Identifies a snapshot file
+constexpr uint8_t       SNAPSHOT_FILE_VERSION = 3; //!< The current version of the snapshot file format
+
+/**
+ * @brief Exports the aggregates to a snapshot file.
+ *
+ * Unlike a state file, a snapshot isn't tied to a log file, so snapshots taken on different machines can be merged.
+ *
+ * @param path The path of the snapshot file. It is replaced atomically.
+ * @param aggregator The aggregates to export.
+ *
+ * @return true If the snapshot was written successfully.
+ * @return false Otherwise.
+ */
+inline bool saveSnapshotFile(const string& path, const ConnectionAggregator& aggregator) {
+    BinaryWriter writer;
+
+    writer.writeBytes(SNAPSHOT_FILE_MAGIC);
+    writer.writeByte(SNAPSHOT_FILE_VERSION);
+    aggregator.serialize(writer);
+
+    return writer.writeToFile(path);
+}
+
+/**
+ * @brief Loads the aggregates from a snapshot file and adds them to the aggregator.
+ *
+ * Loading several snapshots into the same aggregator merges them; each host's records are added to the
+ * existing ones as they're read, so no intermediate aggregators are needed.
+ *
+ * @param path The path of the snapshot file.
+ * @param aggregator The aggregator to add the aggregates to. Must be discarded if loading fails.
+ *
+ * @return true If the snapshot was loaded successfully.
+ * @return false If it couldn't be read, is corrupt, has an unknown version or was written in a different mode.
+ */
+inline bool loadSnapshotFile(const string& path, ConnectionAggregator& aggregator) {
+    BinaryReader reader;
+
+    if (!reader.readFromFile(path) || reader.readBytes(SNAPSHOT_FILE_MAGIC.size()) != SNAPSHOT_FILE_MAGIC || reader.readByte() != SNAPSHOT_FILE_VERSION) {
+        return false;
+    }
+
+    return aggregator.deserialize(reader) && reader.isAtEnd();
+}
+
+#endif // ENDLESSH_REPORT_INCLUDE_SNAPSHOT_HPP
@@ -0,0 +1,151 @@
+/**
+ * @file splitcsvwriter.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains a writer splitting a CSV into numbered files of limited size, e.g. to fit AbuseIPDB's bulk report limits.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_SPLITCSVWRITER_HPP
+#define ENDLESSH_REPORT_INCLUDE_SPLITCSVWRITER_HPP
+
+#include "reportwriter.hpp"
+
+// stl
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// fmt
+#include <fmt/format.h>
+
+using std::string;
+using std::string_view;
+using std::unique_ptr;
+using std::vector;
+
+/**
+ * @brief Writes CSV lines to numbered files (prefix-0001.csv, prefix-0002.csv, ...), starting a new file whenever
+ *        the next line would exceed the line or byte limit. Each file starts with the header.
+ *
+ * Files are only created once there's a line to write to them, so no lines means no files.
+ */
+class SplitCsvWriter {
+    public: // +++ Constants +++
+        constexpr static size_t ABUSEIPDB_MAX_LINES = 10000; //!< The maximum amount of lines per bulk report, including the header
+        constexpr static size_t ABUSEIPDB_MAX_BYTES = 2000000; //!< The maximum size of a bulk report (2 MB)
+
+    public: // +++ Constructor / Destructor +++
+        /**
+         * @param pathPrefix The path of the files, without the number and extension.
+         * @param header The header line of each file, without the line break.
+         * @param maxLines The maximum amount of lines per file, including the header.
+         * @param maxBytes The maximum size of each file.
+         */
+        SplitCsvWriter(string pathPrefix, string header, const size_t maxLines = ABUSEIPDB_MAX_LINES, const size_t maxBytes = ABUSEIPDB_MAX_BYTES):
+            m_pathPrefix(std::move(pathPrefix)), m_header(std::move(header)), m_maxLines(maxLines), m_maxBytes(maxBytes) {}
+        SplitCsvWriter(const SplitCsvWriter&) = delete;
+        SplitCsvWriter& operator=(const SplitCsvWriter&) = delete;
+        ~SplitCsvWriter() { close(); }
+
+    public: // +++ Writing +++
+        /**
+         * @brief Writes a line (without the line break), moving on to the next file if it wouldn't fit in the current one.
+         *
+         * @return true If the line was written.
+         * @return false If a file couldn't be created or written, or the line wouldn't fit in a file of its own (EFBIG);
+         *         nothing is written after that. @see getErrorNumber
+         */
+        bool writeLine(const string_view line) {
+            if (m_hasFailed) { return false; }
+
+            const auto lineBytes = line.size() + 1;
+            if (m_header.size() + 1 + lineBytes > m_maxBytes) {
+                fail(EFBIG);
+                return false;
+            }
+
+            if (m_writer == nullptr || m_lineCount + 1 > m_maxLines || m_byteCount + lineBytes > m_maxBytes) {
+                if (!openNextFile()) { return false; }
+            }
+
+            m_writer->write(line).endLine();
+            m_lineCount++;
+            m_byteCount += lineBytes;
+
+            return true;
+        }
+
+        /**
+         * @brief Finishes the current file.
+         *
+         * @return true If all files were written successfully.
+         * @return false Otherwise.
+         */
+        bool close() {
+            if (m_writer != nullptr) {
+                if (!m_writer->flush()) { fail(m_writer->getErrorNumber()); }
+                m_writer.reset();
+
+                if (std::fclose(m_file) != 0) { fail(); }
+                m_file = nullptr;
+            }
+
+            return !m_hasFailed;
+        }
+
+    public: // +++ Results +++
+        const vector<string>& getPaths() const { return m_paths; } //!< The files written so far; the last one is the one which failed, if a file failed
+        int getErrorNumber() const { return m_errorNumber; } //!< The errno of the first failure, or 0
+
+    private: // +++ Implementation +++
+        bool openNextFile() {
+            if (!close()) { return false; }
+
+            m_paths.push_back(fmt::format("{0:s}-{1:04d}.csv", m_pathPrefix, m_paths.size() + 1));
+            m_file = std::fopen(m_paths.back().c_str(), "wb");
+
+            if (m_file == nullptr) {
+                fail();
+                return false;
+            }
+
+            m_writer = std::make_unique<ReportWriter>(m_file);
+            m_writer->write(m_header).endLine();
+            m_lineCount = 1;
+            m_byteCount = m_header.size() + 1;
+
+            return true;
+        }
+
+        /**
+         * @brief Marks the writer as failed, keeping the errno of the first failure before later calls overwrite it.
+         */
+        void fail(const int errorNumber = errno) {
+            if (!m_hasFailed) { m_errorNumber = errorNumber; }
+            m_hasFailed = true;
+        }
+
+    private: // +++ Members +++
+        string                  m_pathPrefix; //!< The path of the files, without the number and extension
+        string                  m_header; //!< The header line of each file
+        size_t                  m_maxLines; //!< The maximum amount of lines per file, including the header
+        size_t                  m_maxBytes; //!< The maximum size of each file
+
+        FILE*                   m_file{nullptr}; //!< The file being written
+        unique_ptr<ReportWriter> m_writer; //!< Buffers the lines of the file being written
+        size_t                  m_lineCount{0}; //!< The amount of lines in the file being written
+        size_t                  m_byteCount{0}; //!< The size of the file being written
+        vector<string>          m_paths; //!< The files written so far
+        bool                    m_hasFailed{false}; //!< Whether a file couldn't be created or written
+        int                     m_errorNumber{0}; //!< The errno of the first failure
+};
+
+#endif // ENDLESSH_REPORT_INCLUDE_SPLITCSVWRITER_HPP
@@ -0,0 +1,130 @@
+/**
+ * @file tagscanner.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains a vectorised substring search used to find endlessh's entries in raw log buffers.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_TAGSCANNER_HPP
+#define ENDLESSH_REPORT_INCLUDE_TAGSCANNER_HPP
+
+// stl
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#   define ENDLESSH_REPORT_HAVE_X86_SIMD
+#   include <immintrin.h>
+#endif
+
+using std::string_view;
+
+/**
+ * @brief Finds the first occurrence of a tag in a block of memory, one byte at a time.
+ *
+ * @param data The block of memory to search.
+ * @param length The size of the block.
+ * @param tag The tag to search for.
+ *
+ * @return const char* A pointer to the first occurrence of the tag, or nullptr if the block doesn't contain it.
+ */
+inline const char* findTagScalar(const char* data, const size_t length, const string_view tag) {
+    return static_cast<const char*>(memmem(data, length, tag.data(), tag.size()));
+}
+
+#ifdef ENDLESSH_REPORT_HAVE_X86_SIMD
+/**
+ * @brief Finds the first occurrence of a tag in a block of memory, 16 bytes at a time.
+ *
+ * Every position whose byte matches the first character of the tag and whose byte tag.size() - 1 further on matches
+ * the last character is a candidate; only candidates are compared in full. Log text rarely passes both tests,
+ * so almost all of the input is skipped in a handful of instructions per 16 bytes.
+ *
+ * @see findTagScalar
+ */
+__attribute__((target("sse2")))
+inline const char* findTagSse2(const char* data, const size_t length, const string_view tag) {
+    if (tag.size() < 2 || length < tag.size() + 16) { return findTagScalar(data, length, tag); }
+
+    const auto first = _mm_set1_epi8(tag.front());
+    const auto last = _mm_set1_epi8(tag.back());
+    const auto lastOffset = tag.size() - 1;
+
+    size_t position = 0;
+    for (; position + lastOffset + 16 <= length; position += 16) {
+        const auto blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+        const auto blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position + lastOffset));
+        auto candidates = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last))));
+
+        while (candidates != 0) {
+            const auto* candidate = data + position + __builtin_ctz(candidates);
+            if (memcmp(candidate + 1, tag.data() + 1, tag.size() - 2) == 0) { return candidate; }
+            candidates &= candidates - 1;
+        }
+    }
+
+    return findTagScalar(data + position, length - position, tag);
+}
+
+/**
+ * @brief Finds the first occurrence of a tag in a block of memory, 32 bytes at a time.
+ *
+ * @see findTagSse2
+ */
+__attribute__((target("avx2")))
+inline const char* findTagAvx2(const char* data, const size_t length, const string_view tag) {
+    if (tag.size() < 2 || length < tag.size() + 32) { return findTagScalar(data, length, tag); }
+
+    const auto first = _mm256_set1_epi8(tag.front());
+    const auto last = _mm256_set1_epi8(tag.back());
+    const auto lastOffset = tag.size() - 1;
+
+    size_t position = 0;
+    for (; position + lastOffset + 32 <= length; position += 32) {
+        const auto blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position));
+        const auto blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position + lastOffset));
+        auto candidates = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last))));
+
+        while (candidates != 0) {
+            const auto* candidate = data + position + __builtin_ctz(candidates);
+            if (memcmp(candidate + 1, tag.data() + 1, tag.size() - 2) == 0) { return candidate; }
+            candidates &= candidates - 1;
+        }
+    }
+
+    return findTagScalar(data + position, length - position, tag);
+}
+#endif // ENDLESSH_REPORT_HAVE_X86_SIMD
+
+using TagSearchFunction = const char* (*)(const char*, const size_t, const string_view); //!< The signature of the findTag* implementations
+
+/**
+ * @brief Gets the fastest tag search the CPU supports. The choice is made once, on first use.
+ */
+inline TagSearchFunction getTagSearchFunction() {
+    const static TagSearchFunction SEARCH_FUNCTION = []() -> TagSearchFunction {
+#ifdef ENDLESSH_REPORT_HAVE_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) { return findTagAvx2; }
+        if (__builtin_cpu_supports("sse2")) { return findTagSse2; }
+#endif
+        return findTagScalar;
+    }();
+
+    return SEARCH_FUNCTION;
+}
+
+/**
+ * @brief Finds the first occurrence of a tag in a block of memory, using the fastest implementation available.
+ *
+ * @see findTagScalar
+ */
+inline const char* findTag(const char* data, const size_t length, const string_view tag) {
+    return getTagSearchFunction()(data, length, tag);
+}
+
+#endif // ENDLESSH_REPORT_INCLUDE_TAGSCANNER_HPP
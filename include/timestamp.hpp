@@ -0,0 +1,275 @@
+/**
+ * @file timestamp.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains fast parsing of syslog timestamps and a time window to filter log lines by.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_TIMESTAMP_HPP
+#define ENDLESSH_REPORT_INCLUDE_TIMESTAMP_HPP
+
+#include <date/date.h>
+
+// stl
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <string_view>
+#include <utility>
+
+using std::string_view;
+
+/**
+ * @brief Parses a fixed amount of decimal digits.
+ *
+ * @return true If all characters were digits.
+ */
+inline bool parseDigits(const char* str, const uint32_t digitCount, int32_t& value) {
+    value = 0;
+
+    for (uint32_t i = 0; i < digitCount; i++) {
+        if (str[i] < '0' || str[i] > '9') { return false; }
+        value = value * 10 + (str[i] - '0');
+    }
+
+    return true;
+}
+
+/**
+ * @brief Converts a calendar date and time of day into seconds since the epoch, without any time zone conversion.
+ */
+inline int64_t getCivilSeconds(const int32_t year, const int32_t month, const int32_t day, const int32_t hour, const int32_t minute, const int32_t second) {
+    const auto days = date::sys_days{ date::year_month_day{ date::year{ year }, date::month{ static_cast<uint32_t>(month) }, date::day{ static_cast<uint32_t>(day) } } };
+    return static_cast<int64_t>(days.time_since_epoch().count()) * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+/**
+ * @brief Gets the current local wall-clock time, as seconds since the epoch. @see SyslogTimestampParser
+ */
+inline int64_t getLocalWallClockNow() {
+    const auto now = std::time(nullptr);
+    struct tm localTime{};
+    localtime_r(&now, &localTime);
+
+    return getCivilSeconds(localTime.tm_year + 1900, localTime.tm_mon + 1, localTime.tm_mday, localTime.tm_hour, localTime.tm_min, localTime.tm_sec);
+}
+
+/**
+ * @brief Parses the timestamps syslog daemons prefix each line with.
+ *
+ * Both the traditional format ("Oct 16 12:00:00", without a year) and RFC 3339 ("2023-10-16T12:00:00.123+02:00")
+ * are understood. Timestamps are returned as local wall-clock time, i.e. the date and time as written in the log,
+ * counted in seconds since the epoch; no time zone conversions take place, so parsing stays cheap.
+ * As the traditional format has no year, the year is chosen so the timestamp isn't in the future.
+ */
+class SyslogTimestampParser {
+    public: // +++ Constructor / Destructor +++
+        /**
+         * @param now The current local wall-clock time; @see getLocalWallClockNow
+         */
+        explicit SyslogTimestampParser(const int64_t now = getLocalWallClockNow()): m_now(now) {
+            const auto nowTime = static_cast<time_t>(now);
+            struct tm nowFields{};
+            gmtime_r(&nowTime, &nowFields);
+            m_currentYear = nowFields.tm_year + 1900;
+        }
+
+    public: // +++ Parsing +++
+        /**
+         * @brief Parses the timestamp at the start of a log line.
+         *
+         * @param line The line to parse.
+         * @param timestamp Will contain the timestamp, in local wall-clock seconds.
+         *
+         * @return true If the line starts with a timestamp.
+         * @return false Otherwise.
+         */
+        bool parse(const string_view line, int64_t& timestamp) const {
+            if (line.size() >= 19 && line[0] >= '0' && line[0] <= '9') { return parseRfc3339(line, timestamp); }
+            if (line.size() >= 15) { return parseTraditional(line, timestamp); }
+
+            return false;
+        }
+
+        /**
+         * @brief Parses a timestamp in RFC 3339 format; the seconds, fraction and time zone may be omitted.
+         *
+         * Also accepts a space instead of the T between date and time, or only a date.
+         */
+        static bool parseRfc3339(const string_view str, int64_t& timestamp) {
+            int32_t year, month, day, hour = 0, minute = 0, second = 0;
+
+            if (str.size() < 10 || str[4] != '-' || str[7] != '-' ||
+                !parseDigits(str.data(), 4, year) || !parseDigits(str.data() + 5, 2, month) || !parseDigits(str.data() + 8, 2, day)) {
+                return false;
+            }
+
+            if (str.size() >= 16 && (str[10] == 'T' || str[10] == ' ')) {
+                if (str[13] != ':' || !parseDigits(str.data() + 11, 2, hour) || !parseDigits(str.data() + 14, 2, minute)) { return false; }
+                if (str.size() >= 19 && str[16] == ':' && !parseDigits(str.data() + 17, 2, second)) { return false; }
+            }
+
+            if (!isValid(month, day, hour, minute, second)) { return false; }
+
+            timestamp = getCivilSeconds(year, month, day, hour, minute, second);
+            return true;
+        }
+
+    private: // +++ Implementation +++
+        static bool isValid(const int32_t month, const int32_t day, const int32_t hour, const int32_t minute, const int32_t second) {
+            return month >= 1 && month <= 12 && day >= 1 && day <= 31 && hour < 24 && minute < 60 && second <= 60;
+        }
+
+        /**
+         * @brief Parses a timestamp in the traditional BSD syslog format, e.g. "Oct  1 12:00:00".
+         */
+        bool parseTraditional(const string_view str, int64_t& timestamp) const {
+            const auto month = parseMonth(str.data());
+            int32_t day, hour, minute, second;
+
+            if (month == 0 || str[3] != ' ' || str[6] != ' ' || str[9] != ':' || str[12] != ':') { return false; }
+
+            if (str[4] == ' ') {
+                if (!parseDigits(str.data() + 5, 1, day)) { return false; }
+            } else if (!parseDigits(str.data() + 4, 2, day)) {
+                return false;
+            }
+
+            if (!parseDigits(str.data() + 7, 2, hour) || !parseDigits(str.data() + 10, 2, minute) || !parseDigits(str.data() + 13, 2, second) ||
+                !isValid(month, day, hour, minute, second)) {
+                return false;
+            }
+
+            timestamp = getCivilSeconds(m_currentYear, month, day, hour, minute, second);
+
+            // Allow for a little clock skew before deciding the entry is from last year
+            if (timestamp > m_now + 86400) {
+                timestamp = getCivilSeconds(m_currentYear - 1, month, day, hour, minute, second);
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Gets the month (1-12) from its English three-letter abbreviation, or 0.
+         */
+        static int32_t parseMonth(const char* str) {
+            switch ((uint32_t(uint8_t(str[0])) << 16) | (uint32_t(uint8_t(str[1])) << 8) | uint8_t(str[2])) {
+                case 'J' << 16 | 'a' << 8 | 'n': return 1;
+                case 'F' << 16 | 'e' << 8 | 'b': return 2;
+                case 'M' << 16 | 'a' << 8 | 'r': return 3;
+                case 'A' << 16 | 'p' << 8 | 'r': return 4;
+                case 'M' << 16 | 'a' << 8 | 'y': return 5;
+                case 'J' << 16 | 'u' << 8 | 'n': return 6;
+                case 'J' << 16 | 'u' << 8 | 'l': return 7;
+                case 'A' << 16 | 'u' << 8 | 'g': return 8;
+                case 'S' << 16 | 'e' << 8 | 'p': return 9;
+                case 'O' << 16 | 'c' << 8 | 't': return 10;
+                case 'N' << 16 | 'o' << 8 | 'v': return 11;
+                case 'D' << 16 | 'e' << 8 | 'c': return 12;
+                default: return 0;
+            }
+        }
+
+    private: // +++ Members +++
+        int64_t m_now; //!< The current local wall-clock time
+        int32_t m_currentYear; //!< The current year, assumed for timestamps without a year
+};
+
+/**
+ * @brief A range of time, in local wall-clock seconds, to restrict a report to.
+ */
+struct TimeWindow {
+    int64_t since{std::numeric_limits<int64_t>::min()}; //!< The first second in the window
+    int64_t until{std::numeric_limits<int64_t>::max()}; //!< The last second in the window
+
+    bool isRestricted() const { return since != std::numeric_limits<int64_t>::min() || until != std::numeric_limits<int64_t>::max(); }
+    bool contains(const int64_t timestamp) const { return timestamp >= since && timestamp <= until; }
+};
+
+/**
+ * @brief Narrows down where the lines with timestamps at or after the given time start in a chronologically ordered log.
+ *
+ * The log is binary-searched, so only a few pages around the probed offsets are ever touched.
+ * Lines without a timestamp are skipped while probing.
+ *
+ * @param log The log to search; typically a memory-mapped file.
+ * @param timestamp The timestamp to search for.
+ * @param parser The parser to parse the timestamps with.
+ *
+ * @return pair<size_t, size_t> Two line starts; the first line at or after the timestamp lies between them.
+ *         Any lines between the second one and that line don't have a timestamp.
+ */
+inline std::pair<size_t, size_t> bisectLog(const string_view log, const int64_t timestamp, const SyslogTimestampParser& parser) {
+    constexpr size_t LINEAR_SEARCH_THRESHOLD = 64 * 1024; //!< Below this size, the rest is left to the per-line filter
+
+    const char* const data = log.data();
+    size_t lowerBound = 0; // Always at the start of a line; all timestamped lines before it are older
+    size_t upperBound = log.size(); // Always at the start of a line (or the end)
+
+    auto nextLineStart = [&](const size_t offset) -> size_t {
+        const auto* newline = static_cast<const char*>(memchr(data + offset, '\n', log.size() - offset));
+        return newline == nullptr ? log.size() : (newline - data) + 1;
+    };
+
+    while (upperBound - lowerBound > LINEAR_SEARCH_THRESHOLD) {
+        const auto middle = lowerBound + (upperBound - lowerBound) / 2;
+        const auto probeStart = nextLineStart(middle - 1);
+
+        if (probeStart >= upperBound) { break; }
+
+        // Probe the first line with a timestamp at or after the middle
+        auto lineStart = probeStart;
+        int64_t lineTimestamp = 0;
+        bool hasTimestamp = false;
+
+        while (lineStart < upperBound) {
+            const auto lineEnd = nextLineStart(lineStart);
+            if ((hasTimestamp = parser.parse(log.substr(lineStart, lineEnd - lineStart), lineTimestamp))) { break; }
+            lineStart = lineEnd;
+        }
+
+        if (hasTimestamp && lineTimestamp < timestamp) {
+            lowerBound = nextLineStart(lineStart);
+        } else {
+            upperBound = probeStart;
+        }
+    }
+
+    return { lowerBound, upperBound };
+}
+
+/**
+ * @brief Gets the part of a chronologically ordered log which may contain lines in the given time window.
+ *
+ * The part is conservative: it may include a few lines on either side of the window,
+ * so lines must still be filtered individually (@see TimeWindow::contains).
+ *
+ * @param log The log to search; typically a memory-mapped file.
+ * @param window The time window.
+ * @param parser The parser to parse the timestamps with.
+ *
+ * @return pair<size_t, size_t> The offsets of the start and end of the part.
+ */
+inline std::pair<size_t, size_t> findTimeWindow(const string_view log, const TimeWindow& window, const SyslogTimestampParser& parser) {
+    std::pair<size_t, size_t> part{ 0, log.size() };
+
+    if (window.since != std::numeric_limits<int64_t>::min()) {
+        part.first = bisectLog(log, window.since, parser).first;
+    }
+
+    if (window.until != std::numeric_limits<int64_t>::max()) {
+        part.second = bisectLog(log, window.until + 1, parser).second;
+    }
+
+    part.second = std::max(part.first, part.second);
+    return part;
+}
+
+#endif // ENDLESSH_REPORT_INCLUDE_TIMESTAMP_HPP
@@ -0,0 +1,159 @@
+/**
+ * @file tokenizer.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains an allocation-free, single-pass tokenizer for endlessh's key=value log lines.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_TOKENIZER_HPP
+#define ENDLESSH_REPORT_INCLUDE_TOKENIZER_HPP
+
+#include "ipaddress.hpp"
+
+// stl
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+using std::string_view;
+
+/**
+ * @brief The type of event logged by endlessh.
+ */
+enum class EndlesshEventType: uint8_t {
+    Unknown,    //!< Neither ACCEPT nor CLOSE was found
+    Accept,     //!< A client connected to the tarpit
+    Close       //!< A client disconnected from the tarpit
+};
+
+/**
+ * @brief Contains the relevant fields of a single endlessh log line.
+ */
+struct EndlesshEvent {
+    EndlesshEventType   type{EndlesshEventType::Unknown}; //!< ACCEPT/CLOSE
+    IpAddress           host{}; //!< The value of host=, parsed into its binary form
+    uint16_t            port{0}; //!< The value of port=
+    uint64_t            timeMs{0}; //!< The value of time=, in milliseconds (CLOSE only)
+    size_t              bytes{0}; //!< The value of bytes= (CLOSE only)
+};
+
+/**
+ * @brief Checks whether a token starts with the given key and returns the value following it.
+ *
+ * @param token The token to check.
+ * @param key The key, including the trailing '='.
+ * @param value Will contain the value if the key matched.
+ *
+ * @return true If the token starts with the key and has a non-empty value.
+ * @return false Otherwise.
+ */
+inline bool matchKeyValue(const string_view token, const string_view key, string_view& value) {
+    if (token.size() <= key.size() || memcmp(token.data(), key.data(), key.size()) != 0) { return false; }
+
+    value = token.substr(key.size());
+    return true;
+}
+
+/**
+ * @brief Parses a numeric value from a string_view without allocating.
+ *
+ * @param str The string to parse.
+ * @param value Will contain the parsed value. Untouched if parsing fails.
+ */
+template<typename T>
+inline void parseNumber(const string_view str, T& value) {
+    std::from_chars(str.data(), str.data() + str.size(), value);
+}
+
+/**
+ * @brief Parses a decimal amount of seconds (as logged by endlessh, e.g. "20.123") into milliseconds.
+ *
+ * Keeping the time as an integer means sums are exact and don't depend on the order they're added in.
+ *
+ * @param str The string to parse.
+ * @param milliseconds Will contain the parsed value. Untouched if parsing fails.
+ */
+inline void parseMilliseconds(const string_view str, uint64_t& milliseconds) {
+    uint64_t seconds = 0;
+    const auto* const end = str.data() + str.size();
+    const auto result = std::from_chars(str.data(), end, seconds);
+
+    if (result.ec != std::errc()) { return; }
+
+    uint64_t fraction = 0;
+    uint32_t digits = 0;
+
+    if (result.ptr < end && *result.ptr == '.') {
+        for (const auto* digit = result.ptr + 1; digit < end && digits < 3 && *digit >= '0' && *digit <= '9'; digit++, digits++) {
+            fraction = fraction * 10 + static_cast<uint64_t>(*digit - '0');
+        }
+    }
+
+    for (; digits < 3; digits++) { fraction *= 10; }
+
+    milliseconds = seconds * 1000 + fraction;
+}
+
+/**
+ * @brief Tokenizes a single endlessh log line in one left-to-right pass.
+ *
+ * Looks for ACCEPT/CLOSE as well as the host=, port=, time= and bytes= keys.
+ * Nothing is allocated; the host is parsed straight into its binary form.
+ *
+ * @param line The line to tokenize.
+ * @param event The event which will contain the parsed values.
+ *
+ * @return true If a valid host= token was found.
+ * @return false Otherwise.
+ */
+inline bool tokenizeEndlesshLine(const string_view line, EndlesshEvent& event) {
+    event = EndlesshEvent{};
+    bool hasHost = false;
+
+    const char* cursor = line.data();
+    const char* const end = line.data() + line.size();
+
+    while (cursor < end) {
+        if (*cursor == ' ') {
+            cursor++;
+            continue;
+        }
+
+        const auto* tokenEnd = static_cast<const char*>(memchr(cursor, ' ', end - cursor));
+        if (tokenEnd == nullptr) { tokenEnd = end; }
+
+        const string_view token(cursor, tokenEnd - cursor);
+        string_view value;
+        cursor = tokenEnd;
+
+        switch (token.front()) {
+            case 'A':
+                if (token == "ACCEPT") { event.type = EndlesshEventType::Accept; }
+                break;
+            case 'C':
+                if (token == "CLOSE") { event.type = EndlesshEventType::Close; }
+                break;
+            case 'h':
+                if (matchKeyValue(token, "host=", value)) { hasHost = IpAddress::parse(value, event.host); }
+                break;
+            case 'p':
+                if (matchKeyValue(token, "port=", value)) { parseNumber(value, event.port); }
+                break;
+            case 't':
+                if (matchKeyValue(token, "time=", value)) { parseMilliseconds(value, event.timeMs); }
+                break;
+            case 'b':
+                if (matchKeyValue(token, "bytes=", value)) { parseNumber(value, event.bytes); }
+                break;
+            default: break;
+        }
+    }
+
+    return hasHost;
+}
+
+#endif // ENDLESSH_REPORT_INCLUDE_TOKENIZER_HPP
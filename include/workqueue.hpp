@@ -0,0 +1,140 @@
+/**
+ * @file workqueue.hpp
+ * @author Simon Cahill (simon@simonc.eu)
+ * @brief Contains the distribution of work items (e.g. chunks of log files) across a pool of worker threads.
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023 Simon Cahill
+ */
+
+#ifndef ENDLESSH_REPORT_INCLUDE_WORKQUEUE_HPP
+#define ENDLESSH_REPORT_INCLUDE_WORKQUEUE_HPP
+
+// stl
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using std::unique_ptr;
+using std::vector;
+
+/**
+ * @brief Distributes indexed work items across workers, letting idle workers steal items from busy ones.
+ *
+ * The items are split into one contiguous range per worker, each of about the same total cost, so every worker
+ * starts out walking its own part of the input front to back. A worker which runs out of items steals the back half
+ * of the range with the most items left, i.e. the part of the input its owner would get to last, and walks it front to
+ * back as its new range. Each worker thus takes its items in a few contiguous runs, which it can aggregate into one
+ * result each. Each range is guarded by its own mutex, which is only ever contended by a thief.
+ */
+class WorkStealingQueue {
+    public: // +++ Constructor / Destructor +++
+        /**
+         * @param itemCosts The estimated cost (e.g. size in bytes) of each item.
+         * @param workerCount The amount of workers taking items from the queue.
+         * @param isStealing Whether idle workers steal items from busy ones. Without stealing, each worker takes exactly
+         *                   its own range, so which worker takes which items doesn't depend on timing.
+         */
+        WorkStealingQueue(const vector<uint64_t>& itemCosts, const size_t workerCount, const bool isStealing = true):
+            m_ranges(new Range[workerCount]), m_workerCount(workerCount), m_isStealing(isStealing) {
+            uint64_t totalCost = 0;
+            for (const auto cost : itemCosts) { totalCost += cost; }
+
+            // Each range ends at the first item reaching its share of the total cost
+            uint64_t accumulatedCost = 0;
+            size_t item = 0;
+
+            for (size_t worker = 0; worker < workerCount; worker++) {
+                const auto targetCost = totalCost / workerCount * (worker + 1);
+                m_ranges[worker].begin = item;
+
+                while (item < itemCosts.size() && (accumulatedCost < targetCost || worker + 1 == workerCount)) {
+                    accumulatedCost += itemCosts[item++];
+                }
+
+                m_ranges[worker].end = item;
+            }
+        }
+
+    public: // +++ Scheduling +++
+        /**
+         * @brief Takes the next item for a worker: the first of its own range or, if that's empty, the first of a range stolen from another worker.
+         *
+         * @param worker The index of the worker.
+         * @param item Will contain the index of the item.
+         *
+         * @return true If an item was taken.
+         * @return false If all items have been taken.
+         */
+        bool take(const size_t worker, size_t& item) {
+            {
+                auto& range = m_ranges[worker];
+                std::lock_guard<std::mutex> lock(range.mutex);
+
+                if (range.begin < range.end) {
+                    item = range.begin++;
+                    return true;
+                }
+            }
+
+            return m_isStealing && steal(worker, item);
+        }
+
+    private: // +++ Implementation +++
+        struct Range {
+            std::mutex  mutex; //!< Guards begin and end
+            size_t      begin{0}; //!< The next item to be taken by the owner
+            size_t      end{0}; //!< One past the next item to be stolen
+        };
+
+        bool steal(const size_t thief, size_t& item) {
+            while (true) {
+                size_t victim = thief;
+                size_t mostItems = 0;
+
+                for (size_t worker = 0; worker < m_workerCount; worker++) {
+                    std::lock_guard<std::mutex> lock(m_ranges[worker].mutex);
+                    const auto itemsLeft = m_ranges[worker].end - m_ranges[worker].begin;
+
+                    if (itemsLeft > mostItems) {
+                        victim = worker;
+                        mostItems = itemsLeft;
+                    }
+                }
+
+                if (mostItems == 0) { return false; }
+
+                size_t stolenBegin = 0;
+                size_t stolenEnd = 0;
+                {
+                    // The victim may have run dry in the meantime; look again if so
+                    auto& range = m_ranges[victim];
+                    std::lock_guard<std::mutex> lock(range.mutex);
+
+                    if (range.begin == range.end) { continue; }
+
+                    stolenEnd = range.end;
+                    stolenBegin = range.end -= (range.end - range.begin + 1) / 2;
+                }
+
+                // Only one range is locked at a time, so two thieves stealing from each other can't deadlock
+                auto& ownRange = m_ranges[thief];
+                std::lock_guard<std::mutex> lock(ownRange.mutex);
+
+                ownRange.begin = stolenBegin + 1;
+                ownRange.end = stolenEnd;
+                item = stolenBegin;
+
+                return true;
+            }
+        }
+
+    private: // +++ Members +++
+        unique_ptr<Range[]> m_ranges; //!< The remaining items of each worker
+        size_t              m_workerCount; //!< The amount of workers
+        bool                m_isStealing; //!< Whether idle workers steal items from busy ones
+};
+
+#endif // ENDLESSH_REPORT_INCLUDE_WORKQUEUE_HPP
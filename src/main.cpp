@@ -13,22 +13,48 @@
 ////////////////////////////////
 #include <date/date.h> // full path here to remain easy to compile
 
+#include "aggregator.hpp"
+#include "checkpoint.hpp"
 #include "extensions.hpp"
+#include "hostfilter.hpp"
+#include "hosttable.hpp"
+#include "ipstats.hpp"
+#include "logfollower.hpp"
+#include "logreader.hpp"
 #include "options.hpp"
+#include "prefixtrie.hpp"
+#include "profiler.hpp"
+#include "ranking.hpp"
+#include "reportedindex.hpp"
+#include "reportwriter.hpp"
+#include "snapshot.hpp"
+#include "splitcsvwriter.hpp"
+#include "timestamp.hpp"
 #include "version.hpp"
+#include "workqueue.hpp"
 
 ////////////////////////////////
 //  Standard Includes (STL)   //
 ////////////////////////////////
+#include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <fstream>
+#include <cstdlib>
 #include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#include <csignal>
+#include <cstring>
+#include <glob.h>
 #include <regex.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <fmt/format.h>
 
@@ -36,15 +62,18 @@ using fmt::format;
 
 using std::cout;
 using std::cerr;
+using std::chrono::milliseconds;
 using std::chrono::seconds;
+using std::chrono::steady_clock;
 using std::chrono::system_clock;
 using std::endl;
 using std::function;
-using std::ifstream;
 using std::make_pair;
 using std::map;
 using std::pair;
 using std::string;
+using std::string_view;
+using std::unique_ptr;
 using std::vector;
 
 static bool    g_error = false; //!< Whether or not a fatal error occurred
@@ -54,36 +83,137 @@ static bool    g_printIpStatistics = true; //!< Whether or not to print IP stats
 static bool    g_printConnectionStatistics = true; //!< Whether or not to print connection stats (default: true)
 static bool    g_readFromStdIn = false; //!< Whether or not to read from stdin (default: false)
 static bool    g_useDetailedInfo = false; //!< Whether or not reports should be detailed (default: false)
-static string  g_logLocation = "/var/log/syslog"; //!< Default endlessh log location (default: /var/log/syslog)
+static bool    g_logLocationsOverridden = false; //!< Whether or not the default log location was overridden
+static bool    g_printOpenConnections = false; //!< Whether or not to list the connections which are still open (default: false)
+static bool    g_mergeSnapshots = false; //!< Whether or not the given files are snapshots to merge instead of logs (default: false)
+static bool    g_profile = false; //!< Whether or not to profile the report (default: false)
+static bool    g_approximate = false; //!< Whether or not to estimate the statistics per host in a fixed amount of memory (default: false)
+static vector<string> g_logLocations = { "/var/log/syslog" }; //!< Endlessh log locations (default: /var/log/syslog)
+static uint32_t g_threadCount = 1; //!< The amount of threads to parse the log with (default: 1)
+static string  g_stateFile; //!< The state file used to only read new log entries on each run (default: none)
+static string  g_exportFile; //!< The snapshot file to export the aggregated statistics to (default: none)
+static string  g_abuseIpDbSplitPrefix; //!< The path prefix of the files to split the AbuseIPDB CSV into (default: none, print it)
+static string  g_reportedIndexFile; //!< The index of the hosts already reported to AbuseIPDB (default: none, report all hosts)
+static int64_t g_reportCooldownSeconds = 15 * 60; //!< The time after which a host may be reported to AbuseIPDB again (default: 15 minutes)
+static bool    g_reportCooldownOverridden = false; //!< Whether or not the default cooldown was overridden
+static ReportedHostIndex g_reportedIndex; //!< Leaves hosts reported less than g_reportCooldownSeconds ago out of the AbuseIPDB report
+static string  g_profileJsonFile; //!< The file to append the profile to as JSON (default: none, print it to stderr)
+static Profiler g_profiler; //!< Times the stages of the report
+static TimeWindow g_timeWindow; //!< The time window to restrict the report to (default: unrestricted)
+static const SyslogTimestampParser g_timestampParser; //!< Parses the timestamps of the log lines when a time window is set
+static HostFilter g_hostFilter; //!< The prefixes of the hosts to include in or exclude from the report (default: all hosts)
+static RankingField g_rankingField = RankingField::None; //!< The statistic to rank hosts by (default: none, keep the table's order)
+static size_t  g_topCount = SIZE_MAX; //!< The maximum amount of hosts to report (default: all)
+static bool    g_groupByPrefix = false; //!< Whether or not to report statistics per prefix instead of per host (default: false)
+static uint32_t g_prefixLengthV4 = 24; //!< The length of the IPv4 prefixes to group hosts by (default: 24)
+static uint32_t g_prefixLengthV6 = 48; //!< The length of the IPv6 prefixes to group hosts by (default: 48)
+static uint32_t g_minPrefixHosts = 0; //!< The amount of hosts below which a prefix is folded into its parent prefix (default: 0, never)
+static int64_t g_followIntervalSeconds = -1; //!< The interval between reports when following the log; 0: on SIGUSR1 only (default: -1, don't follow)
+
+static volatile sig_atomic_t g_reportRequested = 0; //!< Set by the SIGUSR1 handler when following the log
+
+const static string_view ENDLESSH = "endlessh"; //!< The tag identifying endlessh's entries in the log
+const static uint32_t MAX_THREADS = 1024; //!< The maximum amount of threads to parse the log with
 
 /**
- * @brief Contains information about a given connection.
+ * @brief Contains a host's connections as paired up by the @see ConnectionTracker.
  */
-struct ConnectionDetails {
-    size_t              acceptedConnections; //!< The total amount of accepted connections
-    size_t              closedConnections; //!< The total amount of closed connections
+struct HostConnectionCounts {
+    uint32_t openConnections{0}; //!< The amount of connections still open
+    uint32_t acceptedBeforeLog{0}; //!< The amount of connections closed in the log, but accepted before it started
+};
+
+/**
+ * @brief Passes lines which are already known to contain the endlessh tag (@see LogReader::forEachLineContaining) on to an aggregator.
+ */
+struct EndlesshLineHandler {
+    ConnectionAggregator& aggregator; //!< The aggregator to pass endlessh entries to
 
-    vector<uint16_t>    usedPorts; //!< The amount of ports used.
+    void operator()(const string_view line) const {
+        if (g_profile) { return addProfiledLine(line); }
 
-    double              totalSecondsWasted; //!< The total seconds of bot time wasted
+        int64_t timestamp = 0;
 
-    size_t              totalBytesSent; //!< The total amount of bytes sent to the bots
+        if (g_timeWindow.isRestricted() && (!g_timestampParser.parse(line, timestamp) || !g_timeWindow.contains(timestamp))) {
+            return;
+        }
+
+        if (!g_hostFilter.isActive()) { return aggregator.addLine(line); }
 
-    string              host; //!< The host trying to attack the system.
+        // Filtered hosts are dropped before any aggregation work is done for them
+        EndlesshEvent event;
+        if (tokenizeEndlesshLine(line, event) && g_hostFilter.allows(event.host)) {
+            aggregator.addEvent(event);
+        }
+    }
 
-    ConnectionDetails(): acceptedConnections(0), closedConnections(0),
-    usedPorts({}), totalSecondsWasted(0), totalBytesSent(0), host({}) {}
-    ~ConnectionDetails() = default;
+    /**
+     * @brief Does the same as the call operator, timing each stage of every PROFILE_SAMPLE_INTERVAL-th line in the calling thread's @see ProfileSample.
+     */
+    void addProfiledLine(const string_view line) const {
+        auto& sample = Profiler::getThreadSample();
+        const auto isTimed = sample.endlesshLines++ % Profiler::PROFILE_SAMPLE_INTERVAL == 0;
+        const auto filterStart = isTimed ? Profiler::getWallNanoseconds() : 0;
+        int64_t timestamp = 0;
+
+        sample.timedLines += isTimed ? 1 : 0;
+        const auto isInWindow = !g_timeWindow.isRestricted() || (g_timestampParser.parse(line, timestamp) && g_timeWindow.contains(timestamp));
+
+        const auto parseStart = isTimed ? Profiler::getWallNanoseconds() : 0;
+        sample.addTime(ProfileStage::Filter, filterStart, parseStart);
+        if (!isInWindow) { return; }
+
+        EndlesshEvent event;
+        const auto isEvent = tokenizeEndlesshLine(line, event) && (!g_hostFilter.isActive() || g_hostFilter.allows(event.host));
+
+        const auto aggregateStart = isTimed ? Profiler::getWallNanoseconds() : 0;
+        sample.addTime(ProfileStage::Parse, parseStart, aggregateStart);
+        if (!isEvent) { return; }
+
+        aggregator.addEvent(event);
+        sample.events++;
+        sample.addTime(ProfileStage::Aggregate, aggregateStart, isTimed ? Profiler::getWallNanoseconds() : 0);
+    }
+};
+
+/**
+ * @brief Passes each line containing the endlessh tag on to an aggregator.
+ */
+struct EndlesshLineFilter {
+    ConnectionAggregator& aggregator; //!< The aggregator to pass endlessh entries to
+
+    void operator()(const string_view line) const {
+        if (findTag(line.data(), line.size(), ENDLESSH) != nullptr) {
+            EndlesshLineHandler{ aggregator }(line);
+        }
+    }
 };
 
 static int32_t                                 parseArgs(const int32_t&, char**); //!< Parses command-line arguments
-static map<string, pair<uint32_t, uint32_t>>   getConnections(const vector<string>&); //!< Gets the logged connections
-static vector<ConnectionDetails>               getDetailledConnections(const vector<string>&); //!< Gets a detailled list of logged connections
-static vector<string>                          readEndlesshLog(); //!< Reads the log file into memory
-static void                                    printConnectionStatistics(const uint32_t uniqueIps, const uint32_t totalAccepted, const uint32_t totalClosed, const double totalTimeWasted, const uint32_t totalBytesSent); //!< Print connection statistics
-static void                                    printIpStatsTableHeader(); //!< Prints the markdown header for the statistics table
-static void                                    printIpStats(const map<string, pair<uint32_t, uint32_t>>&, uint32_t& totalAccepted, uint32_t& totalClosed); //!< Prints the IP stats
-static void                                    printDetailedIpStats(const vector<ConnectionDetails>&, uint32_t& totalAccepted, uint32_t& totalClosed); //!< Prints detailed IP stats
+static void                                    addLogLocations(const char* pattern); //!< Adds the log files matching a path or glob pattern
+static bool                                    readEndlesshLog(ConnectionAggregator&); //!< Streams each endlessh entry in the logs into the aggregator
+static bool                                    openLogFile(const string&, LogReader&, string&); //!< Opens a log file, restricted to the time window where possible
+static bool                                    aggregateLogFile(const string&, const uint32_t, ConnectionAggregator&, string&); //!< Streams a single log file into the aggregator
+static bool                                    aggregateFilesInParallel(ConnectionAggregator&); //!< Aggregates multiple log files on separate threads
+static bool                                    aggregateIncrementally(ConnectionAggregator&); //!< Aggregates the entries appended to the log since the last run
+static bool                                    finishRotatedLog(const string&, const LogCheckpoint&, ConnectionAggregator&); //!< Reads the rest of a log which was rotated since the last run
+static void                                    aggregateChunksInParallel(const vector<string_view>&, ConnectionAggregator&); //!< Aggregates chunks of the log on separate threads
+static bool                                    mergeSnapshotFiles(ConnectionAggregator&); //!< Merges the snapshot files into the aggregator
+static bool                                    followLog(ConnectionAggregator&); //!< Follows the log and periodically prints a report
+static void                                    printReport(const ConnectionAggregator&); //!< Prints the report in the selected format
+static bool                                    printProfile(const ConnectionAggregator&); //!< Prints the profile of the report
+static void                                    addProfiledInput(const LogReader&); //!< Adds the input read by a reader to the profile
+static void                                    printAbuseIpDbCsv(ReportWriter&, const ConnectionAggregator&); //!< Prints the AbuseIPDB-compatible CSV report
+static void                                    printConnectionStatistics(ReportWriter&, const uint32_t uniqueIps, const uint32_t uniqueIpsError, const uint32_t totalAccepted, const uint32_t totalClosed, const uint32_t totalAlive, const double totalTimeWasted, const uint32_t totalBytesSent); //!< Print connection statistics
+static void                                    printOpenConnections(ReportWriter&, const ConnectionTracker&); //!< Prints the connections which are still open
+static void                                    sortLogLocationsChronologically(); //!< Sorts the log files oldest first
+static bool                                    parseTimeArgument(const char*, const bool, int64_t&); //!< Parses the argument of --since/--until
+static bool                                    parseDuration(const char*, int64_t&); //!< Parses a duration such as 30s, 15m, 24h, 7d or 2w
+static void                                    printPrefixStats(ReportWriter&, const ConnectionAggregator&); //!< Prints the statistics per prefix
+static PrefixTrie                              buildPrefixTrie(const ConnectionAggregator&); //!< Rolls the statistics per host up into prefixes
+static bool                                    parsePrefixLengths(const char*); //!< Parses the argument of --group-by-prefix
+static vector<const PrefixTrie::Entry*>        rankPrefixes(const vector<PrefixTrie::Entry>&); //!< Selects the prefix stats to report
+static void                                    printApproximateIpStats(ReportWriter&, const ApproximateHostStatistics&); //!< Prints the estimated IP stats of the hosts with the most connections
 
 int main(int32_t argC, char** argV) {
     if (parseArgs(argC, argV) == 1) {
@@ -97,475 +227,943 @@ int main(int32_t argC, char** argV) {
         g_printConnectionStatistics = g_printIpStatistics = false;
     }
 
-    // Read log file
-    const auto logContents = readEndlesshLog();
+    // Open the index up front: it's locked, so a concurrent run reporting the same hosts waits for this one
+    if (!g_reportedIndexFile.empty() && !g_reportedIndex.open(g_reportedIndexFile, g_reportCooldownSeconds, system_clock::to_time_t(system_clock::now()))) {
+        cerr << "Failed to open reported-host index " << g_reportedIndexFile << ": " << (errno == EINVAL ? "not a valid index" : strerror(errno)) << endl;
+        return 1;
+    }
 
-    if (g_error) { return 1; }
+    // Read and aggregate the log in a single pass
+    ConnectionAggregator aggregator(g_useDetailedInfo, g_approximate);
 
-    map<string, pair<uint32_t, uint32_t>> normalConnList;
-    vector<ConnectionDetails> detailedConnList;
+    if (g_followIntervalSeconds >= 0) {
+        return followLog(aggregator) ? 0 : 1;
+    }
 
-    if (!g_useDetailedInfo) {
-        normalConnList = getConnections(logContents);
+    if (g_mergeSnapshots) {
+        const auto mergeTimer = g_profiler.measureStage(ProfileStage::Merge);
+        if (!mergeSnapshotFiles(aggregator)) { return 1; }
     } else {
-        detailedConnList = getDetailledConnections(logContents);
+        const auto readTimer = g_profiler.measureStage(ProfileStage::Read);
+        if (!readEndlesshLog(aggregator)) { return 1; }
+    }
+
+    {
+        const auto outputTimer = g_profiler.measureStage(ProfileStage::Output);
+
+        if (!g_exportFile.empty() && !saveSnapshotFile(g_exportFile, aggregator)) {
+            cerr << "Failed to write snapshot file " << g_exportFile << ": " << strerror(errno) << endl;
+            return 1;
+        }
+
+        printReport(aggregator);
+        if (g_error) { return 1; }
     }
 
-    uint32_t totalAcceptedConnections = 0;
-    uint32_t totalClosedConnections = 0;
+    if (!g_reportedIndex.close()) {
+        cerr << "Failed to update reported-host index " << g_reportedIndexFile << endl;
+        return 1;
+    }
+
+    if (g_profile && !printProfile(aggregator)) { return 1; }
+
+    return 0;
+}
+
+/**
+ * @brief Prints the profile of the report to stderr, or appends it to g_profileJsonFile as a line of JSON.
+ * 
+ * @param aggregator The aggregated connections.
+ * 
+ * @return true If the profile was written successfully.
+ * @return false Otherwise.
+ */
+bool printProfile(const ConnectionAggregator& aggregator) {
+    g_profiler.collectThreadSample();
+    g_profiler.setUniqueHosts(aggregator.getUniqueHosts());
+
+    if (g_profileJsonFile.empty()) {
+        cerr << g_profiler.formatText();
+        return true;
+    }
+
+    // Appended as a single line, so the profiles of consecutive runs can be trended
+    auto* jsonFile = fopen(g_profileJsonFile.c_str(), "a");
+    if (jsonFile == nullptr) {
+        cerr << "Failed to open profile file " << g_profileJsonFile << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    const auto json = g_profiler.formatJson() + '\n';
+    const auto isWritten = fwrite(json.data(), 1, json.size(), jsonFile) == json.size();
+
+    if (fclose(jsonFile) != 0 || !isWritten) {
+        cerr << "Failed to write profile file " << g_profileJsonFile << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Adds the bytes and lines read by a reader to the profile, if profiling.
+ * 
+ * @param reader The reader, after reading.
+ */
+void addProfiledInput(const LogReader& reader) {
+    if (g_profile) { g_profiler.addInput(reader.getBytesRead(), reader.getLineCount()); }
+}
+
+/**
+ * @brief Prints the report for the aggregated connections, in the format selected on the command line.
+ * 
+ * The report is formatted into a single buffer, which is written out in large blocks.
+ * 
+ * @param aggregator The aggregated connections.
+ */
+void printReport(const ConnectionAggregator& aggregator) {
+    const auto& totals = aggregator.getTotals();
+    ReportWriter writer;
 
     if (!g_disableAdvertisement && !g_printAbuseIpDbCsv) {
-        cout << "# Report generated by Endlessh Reporter at " << getCurrentIsoTimestamp() << endl;
+        writer.write("# Report generated by Endlessh Reporter at ").write(getCurrentIsoTimestamp()).endLine();
     }
 
-    if (g_printIpStatistics) {
-        printIpStatsTableHeader();
+    if (g_printIpStatistics && g_groupByPrefix) {
+        printPrefixStats(writer, aggregator);
+        writer.endLine();
+    } else if (g_printIpStatistics && aggregator.isApproximate()) {
+        printApproximateIpStats(writer, *aggregator.getApproximateStatistics());
+        writer.endLine();
+    } else if (g_printIpStatistics) {
+        printIpStatsTableHeader(writer, g_useDetailedInfo);
         if (!g_useDetailedInfo) {
-            printIpStats(normalConnList, totalAcceptedConnections, totalClosedConnections);
+            printIpStats(writer, aggregator.getConnections(), g_rankingField, g_topCount);
         } else {
-            printDetailedIpStats(detailedConnList, totalAcceptedConnections, totalClosedConnections);
+            printDetailedIpStats(writer, aggregator.getDetailedConnections(), g_rankingField, g_topCount);
         }
-        cout << endl;
+        writer.endLine();
     }
 
-    if (g_printConnectionStatistics) {
-        if (!g_useDetailedInfo) {
-            if (totalAcceptedConnections == 0 || totalClosedConnections == 0) {
-                totalAcceptedConnections = totalClosedConnections = 0; // Just make sure they're both zero
-                // This is stupid. I need to refactor the living fuck out of this code...
-                // It's best if I only use the detailed stats and then adjust the list accordingly
-                std::for_each(normalConnList.begin(), normalConnList.end(), [&](const pair<string, pair<uint32_t, uint32_t>>& x) {
-                    totalAcceptedConnections += x.second.first;
-                    totalClosedConnections += x.second.second;
-                });
-            }
-            printConnectionStatistics(normalConnList.size(), totalAcceptedConnections, totalClosedConnections, 0, 0);
-        } else {
-            if (totalAcceptedConnections == 0 || totalClosedConnections == 0) {
-                totalAcceptedConnections = totalClosedConnections = 0; // Just make sure they're both zero
-                // Again. Totally stupid. I need to refactor this. Big time.
-                std::for_each(detailedConnList.begin(), detailedConnList.end(), [&](const ConnectionDetails& x) {
-                    totalAcceptedConnections += x.acceptedConnections;
-                    totalClosedConnections += x.closedConnections;
-                });
-            }
+    if (g_printOpenConnections && !g_printAbuseIpDbCsv) {
+        printOpenConnections(writer, aggregator.getConnectionTracker());
+        writer.endLine();
+    }
 
-            double totalSeconds = 0;
-            size_t totalBytes = 0;
-            std::for_each(detailedConnList.begin(), detailedConnList.end(), [&](const ConnectionDetails& x) {
-                totalBytes += x.totalBytesSent;
-                totalSeconds += x.totalSecondsWasted;
-            });
+    if (g_printConnectionStatistics) {
+        const auto* approximateStatistics = aggregator.getApproximateStatistics();
 
-            printConnectionStatistics(detailedConnList.size(), totalAcceptedConnections, totalClosedConnections, totalSeconds, totalBytes);
-        }
+        printConnectionStatistics(
+            writer, aggregator.getUniqueHosts(), approximateStatistics == nullptr ? 0 : approximateStatistics->getUniqueHostsError(), totals.acceptedConnections, totals.closedConnections,
+            aggregator.getOpenConnections(), totals.getSecondsWasted(), totals.totalBytesSent
+        );
     }
 
     if (g_printAbuseIpDbCsv) {
-        cerr << "Using categories for hacking, brute-force, sshd, port sniffing" << endl;
-        auto categories = "18,14,22,15";
-        auto timestamp = getCurrentIsoTimestamp();
-        
-        const auto advertisement = format(R"(Report generated by {0:s} v{1:s})", getLongProjectName(), getApplicationVersion());
-        const auto regularCommentFmt = format(
-            "{{0:s}} fell into Endlessh tarpit; {{1:d}}/{{2:d}} total connections are currently still open. {0:s}",
-            g_disableAdvertisement ? string() : advertisement
-        );
-        const auto detailedCommentFmt = format(
-            "{{0:s}} fell into Endlessh tarpit; {{1:d}}/{{2:d}} total connections are currently still open. Total time wasted: {{3:s}}. Total bytes sent by tarpit: {{4:s}}. {0:s}",
-            g_disableAdvertisement ? string() : advertisement
-        );
+        printAbuseIpDbCsv(writer, aggregator);
+    }
+}
 
-        cout << "IP,Categories,ReportDate,Comment" << endl;
+/**
+ * @brief Prints the aggregated connections as AbuseIPDB-compatible CSV, or writes them to g_abuseIpDbSplitPrefix-*.csv.
+ * 
+ * Each row is formatted into the same buffer, which is then passed on to the writer.
+ * 
+ * @param writer The writer to print to.
+ * @param aggregator The aggregated connections.
+ */
+void printAbuseIpDbCsv(ReportWriter& writer, const ConnectionAggregator& aggregator) {
+    cerr << "Using categories for hacking, brute-force, sshd, port sniffing" << endl;
+    const string_view categories = "18,14,22,15";
+    const string_view header = "IP,Categories,ReportDate,Comment";
+    const auto timestamp = getCurrentIsoTimestamp();
+    const int64_t now = system_clock::to_time_t(system_clock::now());
 
-        if (g_useDetailedInfo) {
-            for (const auto& entry : detailedConnList) {
-                auto ip = entry.host;
-                const auto offset = ip.find("::ffff:");
-                if (offset != string::npos) {
-                    ip = ip.substr(offset + 7);
-                }
+    const auto advertisement = g_disableAdvertisement ? string() : format(R"(Report generated by {0:s} v{1:s})", getLongProjectName(), getApplicationVersion());
 
-                int32_t totalConnections = entry.closedConnections;
-                int32_t openConnections = entry.acceptedConnections - totalConnections;
+    // Connections accepted before the log started (e.g. before it was rotated) only show up as a CLOSE
+    map<IpAddress, HostConnectionCounts> connectionsPerHost;
+    const auto& tracker = aggregator.getConnectionTracker();
 
-                if (openConnections < 0) {
-                    // This can happen if the log was rotated before a connection was closed
-                    openConnections *= -1;
-                    totalConnections += openConnections;
-                }
+    tracker.forEachOpenConnection([&connectionsPerHost](const ConnectionKey& key) { connectionsPerHost[key.host].openConnections++; });
+    for (const auto& orphan : tracker.getOrphanedCloses()) { connectionsPerHost[orphan.key.host].acceptedBeforeLog++; }
 
-                fmt::print(
-                    R"({0:s},"{1:s}",{2:s},"{3:s}"{4:s})",
-                    ip, categories, timestamp,
-                    format(
-                        detailedCommentFmt,
-                        ip, openConnections, totalConnections,
-                        getHumanReadableTime(entry.totalSecondsWasted),
-                        getHumanReadableBytes(entry.totalBytesSent)
-                    ), "\n"
-                );
-            }
-        } else {
-            for (const auto& entry : normalConnList) {
-                // strip ::ffff: from IP address
-                auto ip = entry.first;
-                auto offset = ip.find("::ffff:");
-                if (offset != string::npos) {
-                    ip = ip.substr(offset + 7);
-                }
+    unique_ptr<SplitCsvWriter> splitWriter;
+    if (!g_abuseIpDbSplitPrefix.empty()) {
+        splitWriter = std::make_unique<SplitCsvWriter>(g_abuseIpDbSplitPrefix, string(header));
+    } else {
+        writer.write(header).endLine();
+    }
 
-                int32_t closedConnections = entry.second.second;
-                int32_t openConnections = entry.second.first - closedConnections;
+    fmt::memory_buffer row;
+    char hostBuffer[INET6_ADDRSTRLEN];
 
-                if (openConnections < 0) {
-                    // This can happen if the log was rotated before a connection was closed
-                    openConnections *= -1;
-                    closedConnections += openConnections;
-                }
+    const HostConnectionCounts noCounts;
+    vector<IpAddress> reportedHosts;
 
-                fmt::print(
-                    R"({0:s},"{1:s}",{2:s},"{3:s}"{4:s})",
-                    ip, categories, timestamp,
-                    format(
-                        regularCommentFmt,
-                        ip, openConnections, closedConnections
-                    ), "\n"
-                );
-            }
+    // Formats and writes the row of a host unless it was reported recently (see --reported-index); details are null outside of detailed mode.
+    // Returns false once a split file couldn't be written.
+    const auto writeRow = [&](const IpAddress& host, const uint32_t acceptedConnections, const ConnectionDetails* details) {
+        if (!g_reportedIndex.isDue(host, now)) { return true; }
+
+        const auto ip = host.toChars(hostBuffer);
+        const auto countsEntry = connectionsPerHost.find(host);
+        const auto& counts = countsEntry == connectionsPerHost.end() ? noCounts : countsEntry->second;
+        const uint32_t totalConnections = acceptedConnections + counts.acceptedBeforeLog;
+
+        row.clear();
+        fmt::format_to(
+            std::back_inserter(row),
+            R"({0:s},"{1:s}",{2:s},"{0:s} fell into Endlessh tarpit; {3:d}/{4:d} total connections are currently still open. )",
+            ip, categories, timestamp, counts.openConnections, totalConnections
+        );
+
+        if (details != nullptr) {
+            fmt::format_to(
+                std::back_inserter(row), "Total time wasted: {0:s}. Total bytes sent by tarpit: {1:s}. ",
+                getHumanReadableTime(details->getSecondsWasted()), getHumanReadableBytes(details->totalBytesSent)
+            );
+        }
+
+        row.append(advertisement.data(), advertisement.data() + advertisement.size());
+        row.push_back('"');
+
+        const string_view line(row.data(), row.size());
+        if (splitWriter == nullptr) {
+            writer.write(line).endLine();
+        } else if (!splitWriter->writeLine(line)) {
+            return false;
+        }
+
+        if (g_reportedIndex.isOpen()) { reportedHosts.push_back(host); }
+        return true;
+    };
+
+    if (g_useDetailedInfo) {
+        for (const auto* connection : rankHosts(aggregator.getDetailedConnections(), g_rankingField, g_topCount)) {
+            if (!writeRow(connection->host, connection->acceptedConnections, connection)) { break; }
+        }
+    } else {
+        for (const auto* connection : rankHosts(aggregator.getConnections(), g_rankingField, g_topCount)) {
+            if (!writeRow(connection->first, connection->second.first, nullptr)) { break; }
         }
     }
 
-    return 0;
+    // Hosts are only marked as reported once the files holding them were written completely
+    if (splitWriter != nullptr && !splitWriter->close()) {
+        const auto& paths = splitWriter->getPaths();
+        cerr << "Failed to write " << (paths.empty() ? g_abuseIpDbSplitPrefix + "-*.csv" : paths.back()) << ": " << strerror(splitWriter->getErrorNumber()) << endl;
+        g_error = true;
+        return;
+    }
+
+    // Likewise, hosts printed to stdout are only marked once their rows were written out
+    if (splitWriter == nullptr && !writer.flush()) {
+        cerr << "Failed to write the report: " << strerror(writer.getErrorNumber()) << endl;
+        g_error = true;
+        return;
+    }
+
+    // A failed update closes the index; it's reported when closing it in main
+    for (const auto& host : reportedHosts) {
+        if (g_reportedIndex.isOpen()) { g_reportedIndex.markReported(host, now); }
+    }
+
+    if (splitWriter == nullptr) { return; }
+
+    // The paths of the files are the report, e.g. to pass on to an upload script
+    for (const auto& path : splitWriter->getPaths()) { writer.write(path).endLine(); }
 }
 
 /**
- * @brief Reads the file under g_logLocation and filters it for entries containing endlessh
+ * @brief Reads the files under g_logLocations (or stdin) and streams each entry containing endlessh into the aggregator.
  * 
- * @return vector<string> A vector containing all endlessh entries
+ * Logs are mapped into memory where possible; each line is aggregated the moment it is read
+ * and never copied, so memory usage depends only on the amount of unique hosts.
+ * Multiple files are processed in parallel if more than one thread is requested.
+ * 
+ * @param aggregator The aggregator to pass the endlessh entries to.
+ * 
+ * @return true If the logs were read successfully.
+ * @return false Otherwise. g_error is set.
  */
-vector<string> readEndlesshLog() {
-    const static string ENDLESSH = "endlessh";
+bool readEndlesshLog(ConnectionAggregator& aggregator) {
+    string errorMessage;
 
-    vector<string> output;
+    if (g_readFromStdIn) {
+        LogReader reader;
+        reader.openStdIn();
+        reader.setLineCounting(g_profile);
 
-    auto _ = [](std::istream& stream, vector<string>& output) {
-        string line;
-        while (std::getline(stream, line)) {
-            if (line.find(ENDLESSH) != string::npos) {
-                output.push_back(line);
+        if (!reader.forEachLineContaining(ENDLESSH, EndlesshLineHandler{ aggregator })) {
+            cerr << "Failed to read stdin: " << strerror(errno) << endl;
+            g_error = true;
+        }
+
+        addProfiledInput(reader);
+    } else if (!g_stateFile.empty()) {
+        g_error = !aggregateIncrementally(aggregator);
+    } else if (g_threadCount > 1 && g_logLocations.size() > 1) {
+        g_error = !aggregateFilesInParallel(aggregator);
+    } else {
+        for (const auto& logLocation : g_logLocations) {
+            if (!aggregateLogFile(logLocation, g_threadCount, aggregator, errorMessage)) {
+                cerr << errorMessage << endl;
+                g_error = true;
+                break;
             }
         }
-    };
+    }
 
-    if (!g_readFromStdIn) {
-        ifstream fileStream(g_logLocation);
+    return !g_error;
+}
 
-        if (!fileStream.good()) {
-            cerr << "Failed to open " + g_logLocation + "." << endl;
-            g_error = true;
-            return output;
-        }
+/**
+ * @brief Opens a log file for reading. If it's mapped and g_timeWindow is restricted, only the part covering the window is read.
+ * 
+ * @param logLocation The path to the log file.
+ * @param reader The reader to open the log file with.
+ * @param errorMessage Will contain a description of the error, if one occurs.
+ * 
+ * @return true If the log was opened successfully.
+ * @return false Otherwise.
+ */
+bool openLogFile(const string& logLocation, LogReader& reader, string& errorMessage) {
+    if (!reader.open(logLocation)) {
+        errorMessage = format("Failed to open {0:s}: {1:s}", logLocation, strerror(errno));
+        return false;
+    }
 
-        _(fileStream, output);
-    } else {
-        _(std::cin, output);
+    if (g_timeWindow.isRestricted() && reader.isMapped()) {
+        // Jump straight to the part of the log covering the time window, without touching the rest
+        const auto window = findTimeWindow(reader.getMappedInput(), g_timeWindow, g_timestampParser);
+        reader.setStartOffset(window.first);
+        reader.setStopOffset(window.second);
     }
 
-    return output;
+    return true;
 }
 
 /**
- * @brief Gets a map containing all of the opened and closed connections to the server.
+ * @brief Reads a single log file and streams each entry containing endlessh into the aggregator.
  * 
- * @param logContents The contents of the log file as an array of lines.
+ * @param logLocation The path to the log file.
+ * @param threadCount The amount of threads to use; if greater than one, the file is split into chunks if possible.
+ * @param aggregator The aggregator to pass the endlessh entries to.
+ * @param errorMessage Will contain a description of the error, if one occurs.
  * 
- * @return map<string, pair<uint32_t, uint32_t>> A map containing the basic connection statistics.
+ * @return true If the log was read successfully.
+ * @return false Otherwise.
  */
-map<string, pair<uint32_t, uint32_t>> getConnections(const vector<string>& logContents) {
-    map<string, pair<uint32_t, uint32_t>> connections;
+bool aggregateLogFile(const string& logLocation, const uint32_t threadCount, ConnectionAggregator& aggregator, string& errorMessage) {
+    LogReader reader;
 
-    for (const auto& line : logContents) {
-        vector<string> tokens;
-        if (!splitString(line, " ", tokens)) {
-            cerr << "Failed to parse " << line << "." << endl;
-            continue;
+    if (!openLogFile(logLocation, reader, errorMessage)) { return false; }
+
+    if (threadCount > 1) {
+        // Only mapped inputs can be split; everything else is read on this thread
+        const auto chunks = reader.getChunks(threadCount);
+
+        if (chunks.size() > 1) {
+            aggregateChunksInParallel(chunks, aggregator);
+            return true;
         }
+    }
 
-        bool isAccept = false;
-        string hostToken;
+    reader.setLineCounting(g_profile);
 
-        for (const auto& token : tokens) {
-            if (regexMatch(token.c_str(), R"(host=[^\s])")) {
-                hostToken = token.substr(token.find('=') + 1);
-            } else if (token == "ACCEPT") {
-                isAccept = true;
-            }
+    if (!reader.forEachLineContaining(ENDLESSH, EndlesshLineHandler{ aggregator })) {
+        errorMessage = format("Failed to read {0:s}: {1:s}", logLocation, strerror(errno));
+        return false;
+    }
+
+    addProfiledInput(reader);
+    return true;
+}
+
+/**
+ * @brief Aggregates the files in g_logLocations on a pool of g_threadCount threads and merges the results.
+ * 
+ * Mapped files are split into chunks of at least MIN_CHUNK_SIZE, small enough to give each thread several of them, so
+ * a single large file is spread across the pool like any other. Files which can't be mapped (i.e. compressed ones) can't
+ * be split and are read as a whole. The chunks and files are distributed by a @see WorkStealingQueue, so threads which
+ * run out of work take over chunks from those still busy.
+ * 
+ * The files are only opened one at a time to plan the work, then again by the thread reading each chunk, so no more
+ * files than threads are open at once. Each thread aggregates each contiguous run of chunks and files it takes into
+ * its own @see ConnectionAggregator; there are only a few of these per thread, however many files are passed. In
+ * approximate mode, threads don't take over work, so each takes a single run and holds a single set of sketches.
+ * The partial results are merged in the order the files were passed, so the result is identical to a single-threaded run.
+ * 
+ * @param aggregator The aggregator to merge the results into.
+ * 
+ * @return true If all files were read successfully.
+ * @return false Otherwise.
+ */
+bool aggregateFilesInParallel(ConnectionAggregator& aggregator) {
+    constexpr uint64_t MIN_CHUNK_SIZE = 8 * 1024 * 1024; //!< Smaller chunks don't pay off the cost of mapping the file for them
+    constexpr uint64_t CHUNKS_PER_THREAD = 4; //!< The amount of chunks per thread, if the input is large enough
+    constexpr uint64_t COMPRESSION_RATIO = 8; //!< The assumed ratio of compressed files, to estimate the cost of reading them
+
+    /**
+     * @brief A chunk of a mapped log file, or an entire log file which can't be mapped.
+     */
+    struct LogWorkItem {
+        size_t      fileIndex; //!< The index of the file in g_logLocations
+        uint64_t    inode; //!< The inode of the file when the work was planned
+        bool        isWholeFile; //!< Whether the file is read as a whole
+        uint64_t    startOffset; //!< The offset of the chunk in the file, unless the file is read as a whole
+        uint64_t    stopOffset; //!< The offset just past the chunk, unless the file is read as a whole
+    };
+
+    /**
+     * @brief The aggregates of a contiguous run of work items, taken by a single thread.
+     */
+    struct PartialResult {
+        size_t                  firstItem; //!< The index of the first item in the run
+        ConnectionAggregator    aggregator; //!< The aggregates of the items in the run
+    };
+
+    const auto fileCount = g_logLocations.size();
+    uint64_t totalBytes = 0;
+
+    for (const auto& logLocation : g_logLocations) {
+        struct stat fileInfo{};
+        if (stat(logLocation.c_str(), &fileInfo) == 0) { totalBytes += static_cast<uint64_t>(fileInfo.st_size); }
+    }
+
+    const auto chunkSize = std::max(MIN_CHUNK_SIZE, totalBytes / (g_threadCount * CHUNKS_PER_THREAD));
+    vector<LogWorkItem> items;
+    vector<uint64_t> itemCosts;
+    bool success = true;
+
+    for (size_t i = 0; i < fileCount; i++) {
+        LogReader reader;
+        string errorMessage;
+
+        if (!openLogFile(g_logLocations[i], reader, errorMessage)) {
+            cerr << errorMessage << endl;
+            success = false;
+            continue;
         }
 
-        if (hostToken.empty()) {
-            // cerr << "Failed to find host= token!" << endl;
-            // cerr << "\tLine: " << line << endl;
+        if (!reader.isMapped()) {
+            items.push_back({ i, reader.getInode(), true, 0, 0 });
+            itemCosts.push_back(reader.getFileSize() * (reader.isCompressed() ? COMPRESSION_RATIO : 1));
             continue;
         }
 
-        auto iterator = connections.find(hostToken);
-        if (iterator == connections.end()) {
-            connections.emplace(
-                hostToken,
-                make_pair<uint32_t, uint32_t>(
-                    isAccept ? 1 : 0, //    ACCEPT
-                    isAccept ? 0 : 0 //     CLOSE
-                )
-            );
-        } else if (isAccept) {
-            iterator->second.first++;
-        } else {
-            iterator->second.second++;
+        const auto* mapping = reader.getMappedInput().data();
+        uint64_t fileBytes = 0;
+        for (const auto& range : reader.getChunks(1)) { fileBytes += range.size(); }
+
+        for (const auto& chunk : reader.getChunks(static_cast<size_t>((fileBytes + chunkSize - 1) / chunkSize))) {
+            const auto startOffset = static_cast<uint64_t>(chunk.data() - mapping);
+            items.push_back({ i, reader.getInode(), false, startOffset, startOffset + chunk.size() });
+            itemCosts.push_back(chunk.size());
         }
     }
 
-    return connections;
+    // Don't read any of the files if one of them can't be, as the result would be discarded anyway
+    if (!success) { return false; }
+
+    const auto threadCount = std::max<size_t>(1, std::min<size_t>(g_threadCount, items.size()));
+    // The heavy hitters of approximate mode depend on how the items are grouped, so they're grouped the same every time
+    WorkStealingQueue queue(itemCosts, threadCount, !aggregator.isApproximate());
+    vector<vector<PartialResult>> partialResults(threadCount);
+    vector<string> errorMessages(items.size());
+    vector<std::thread> threads;
+
+    g_profiler.setReadThreads(static_cast<uint32_t>(threadCount));
+
+    for (size_t worker = 0; worker < threadCount; worker++) {
+        threads.emplace_back([&, worker]() {
+            auto& runs = partialResults[worker];
+            size_t itemIndex = 0;
+            size_t nextItem = SIZE_MAX;
+
+            while (queue.take(worker, itemIndex)) {
+                if (itemIndex != nextItem) {
+                    runs.push_back({ itemIndex, ConnectionAggregator(aggregator.isDetailed(), aggregator.isApproximate()) });
+                }
+                nextItem = itemIndex + 1;
+
+                const auto& item = items[itemIndex];
+                const auto& logLocation = g_logLocations[item.fileIndex];
+                LogReader reader;
+
+                if (!reader.open(logLocation)) {
+                    errorMessages[itemIndex] = format("Failed to open {0:s}: {1:s}", logLocation, strerror(errno));
+                    continue;
+                } else if (reader.getInode() != item.inode || (!item.isWholeFile && reader.getMappedInput().size() < item.stopOffset)) {
+                    errorMessages[itemIndex] = format("Failed to read {0:s}: it was replaced or truncated while reading it", logLocation);
+                    continue;
+                }
+
+                if (!item.isWholeFile) {
+                    reader.setStartOffset(item.startOffset);
+                    reader.setStopOffset(item.stopOffset);
+                }
+
+                reader.setLineCounting(g_profile);
+
+                if (!reader.forEachLineContaining(ENDLESSH, EndlesshLineHandler{ runs.back().aggregator })) {
+                    errorMessages[itemIndex] = format("Failed to read {0:s}: {1:s}", logLocation, strerror(errno));
+                }
+
+                addProfiledInput(reader);
+            }
+
+            if (g_profile) { g_profiler.collectThreadSample(); }
+        });
+    }
+
+    for (auto& thread : threads) { thread.join(); }
+
+    const auto mergeTimer = g_profiler.measureStage(ProfileStage::Merge);
+
+    for (size_t i = 0; i < items.size(); i++) {
+        // A file's chunks are consecutive items; report each file only once
+        if (errorMessages[i].empty() || (i > 0 && !errorMessages[i - 1].empty() && items[i - 1].fileIndex == items[i].fileIndex)) { continue; }
+
+        cerr << errorMessages[i] << endl;
+        success = false;
+    }
+
+    if (!success) { return false; }
+
+    vector<PartialResult*> orderedResults;
+    for (auto& runs : partialResults) {
+        for (auto& run : runs) { orderedResults.push_back(&run); }
+    }
+
+    std::sort(orderedResults.begin(), orderedResults.end(), [](const PartialResult* a, const PartialResult* b) { return a->firstItem < b->firstItem; });
+    for (const auto* run : orderedResults) { aggregator.merge(run->aggregator); }
+
+    return true;
 }
 
 /**
- * @brief Gets a list with detailled information about all the incoming connections to the server.
+ * @brief Restores the aggregates from g_stateFile, adds the entries appended to the log since then and updates the state file.
+ * 
+ * The state file records the log's inode and the offset of the last complete line read.
+ * If the inode changed, the log was rotated; the rest of the previous log is read first (if it can be found),
+ * then the new log from the start. If the log shrank, it was truncated and is read from the start.
  * 
- * @param logContents The log file contents passed as an array of lines.
+ * @param aggregator The aggregator to restore the state into and pass the new endlessh entries to.
  * 
- * @return vector<ConnectionDetails> A list of @see ConnectionDetails containing all the goodies.
+ * @return true If the log was read and the state file updated successfully.
+ * @return false Otherwise.
  */
-vector<ConnectionDetails> getDetailledConnections(const vector<string>& logContents) {
-    vector<ConnectionDetails> returnVal{};
+bool aggregateIncrementally(ConnectionAggregator& aggregator) {
+    const auto& logLocation = g_logLocations.front();
 
-    for (const auto& line : logContents) {
-        vector<string> tokens;
-        if (!splitString(line, " ", tokens)) {
-            cerr << "Failed to parse " << line << "." << endl;
-            continue;
-        }
+    LogCheckpoint checkpoint;
+    {
+        ConnectionAggregator restoredState(aggregator.isDetailed());
 
-        bool isAccept = false;
-        string hostToken;
-        string portToken;
-        string timeToken;
-        string bytesToken;
-
-        for (const auto& token : tokens) {
-            if (regexMatch(token.c_str(), R"(host=[^\s])")) {
-                hostToken = token.substr(token.find('=') + 1);
-            } else if (token == "ACCEPT") {
-                isAccept = true;
-            } else if (regexMatch(token.c_str(), R"(port=[^\s])") && token.find('=') != string::npos) {
-                portToken = token.substr(token.find('=') + 1);
-            } else if (regexMatch(token.c_str(), R"(time=[^\s])") && token.find('=') != string::npos) {
-                timeToken = token.substr(token.find('=') + 1);
-            } else if (regexMatch(token.c_str(), R"(bytes=[^\s])") && token.find('=') != string::npos) {
-                bytesToken = token.substr(token.find('=') + 1);
+        if (loadStateFile(g_stateFile, checkpoint, restoredState)) {
+            aggregator = std::move(restoredState);
+        } else {
+            if (access(g_stateFile.c_str(), F_OK) == 0) {
+                cerr << "[WARNING] Ignoring unusable state file " << g_stateFile << " (corrupt, or written in a different mode)." << endl;
             }
+            checkpoint = LogCheckpoint{};
+        }
+    }
+
+    LogReader reader;
+    if (!reader.open(logLocation)) {
+        cerr << "Failed to open " << logLocation << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    if (checkpoint.isValid()) {
+        if (reader.getInode() != checkpoint.inode || reader.getDevice() != checkpoint.device) {
+            finishRotatedLog(logLocation, checkpoint, aggregator);
+        } else if (reader.getFileSize() >= checkpoint.offset) {
+            reader.setStartOffset(checkpoint.offset);
         }
+    }
+
+    // The last line may still be being written; leave it for the next run
+    reader.setLineCounting(g_profile);
+    if (!reader.forEachLineContaining(ENDLESSH, EndlesshLineHandler{ aggregator }, false)) {
+        cerr << "Failed to read " << logLocation << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    addProfiledInput(reader);
+
+    checkpoint = LogCheckpoint{ reader.getDevice(), reader.getInode(), reader.getEndOffset() };
+
+    if (!saveStateFile(g_stateFile, checkpoint, aggregator)) {
+        cerr << "Failed to write state file " << g_stateFile << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Reads the remainder of a log which has been rotated since the checkpoint was taken.
+ * 
+ * The rotated log is searched for next to the current one (e.g. syslog.1) by its inode.
+ * 
+ * @param logLocation The path of the current log.
+ * @param checkpoint The checkpoint of the rotated log.
+ * @param aggregator The aggregator to pass the endlessh entries to.
+ * 
+ * @return true If the rotated log was found and read.
+ * @return false Otherwise. A warning is printed, as entries may have been missed.
+ */
+bool finishRotatedLog(const string& logLocation, const LogCheckpoint& checkpoint, ConnectionAggregator& aggregator) {
+    for (const auto& suffix : { ".1", ".0", "-old" }) {
+        const auto candidate = logLocation + suffix;
 
-        if (hostToken.empty()) {
-            // cerr << "Failed to find host= token!" << endl;
-            // cerr << "\tLine: " << line << endl;
+        struct stat fileInfo{};
+        if (stat(candidate.c_str(), &fileInfo) != 0 || static_cast<uint64_t>(fileInfo.st_ino) != checkpoint.inode || static_cast<uint64_t>(fileInfo.st_dev) != checkpoint.device) {
             continue;
         }
 
-        auto element = std::find_if(returnVal.begin(), returnVal.end(), [&](const ConnectionDetails x) {
-            return x.host == hostToken;
+        LogReader reader;
+        reader.setLineCounting(g_profile);
+        if (!reader.open(candidate, checkpoint.offset) || !reader.forEachLineContaining(ENDLESSH, EndlesshLineHandler{ aggregator })) {
+            break;
+        }
+
+        addProfiledInput(reader);
+        return true;
+    }
+
+    cerr << "[WARNING] " << logLocation << " was rotated, but the previous log could not be found; entries may have been missed." << endl;
+    return false;
+}
+
+/**
+ * @brief Aggregates each chunk of the log on its own thread and merges the results.
+ * 
+ * Each thread aggregates into its own @see ConnectionAggregator, so no locking is required.
+ * The partial results are merged in the order of the chunks, so the result is identical to a single-threaded run.
+ * 
+ * @param chunks The chunks of the log, as returned by @see LogReader::getChunks.
+ * @param aggregator The aggregator to merge the results into.
+ */
+void aggregateChunksInParallel(const vector<string_view>& chunks, ConnectionAggregator& aggregator) {
+    vector<ConnectionAggregator> partialResults;
+    vector<std::thread> threads;
+
+    partialResults.reserve(chunks.size());
+    threads.reserve(chunks.size());
+
+    for (size_t i = 0; i < chunks.size(); i++) {
+        partialResults.emplace_back(aggregator.isDetailed(), aggregator.isApproximate());
+    }
+
+    g_profiler.setReadThreads(static_cast<uint32_t>(chunks.size()));
+
+    for (size_t i = 0; i < chunks.size(); i++) {
+        threads.emplace_back([&chunks, &partialResults, i]() {
+            if (!g_profile) {
+                LogReader::forEachLineContainingIn(chunks[i], ENDLESSH, EndlesshLineHandler{ partialResults[i] });
+                return;
+            }
+
+            uint64_t lineCount = 0;
+            LogReader::forEachLineContainingIn(chunks[i], ENDLESSH, EndlesshLineHandler{ partialResults[i] }, lineCount);
+            g_profiler.addInput(chunks[i].size(), lineCount);
+            g_profiler.collectThreadSample();
         });
+    }
 
-        if (element == returnVal.end()) {
-            ConnectionDetails x;
-            x.host = hostToken;
-            element = returnVal.emplace(returnVal.cend(), std::move(x));
-        }
+    for (auto& thread : threads) { thread.join(); }
 
-        if (isAccept) {
-            element->acceptedConnections++;
-            element->usedPorts.push_back(static_cast<uint16_t>(std::stoul(portToken)));
-            continue;
+    const auto mergeTimer = g_profiler.measureStage(ProfileStage::Merge);
+    for (const auto& partialResult : partialResults) {
+        aggregator.merge(partialResult);
+    }
+}
+
+/**
+ * @brief Merges the snapshot files given on the command line into the aggregator.
+ * 
+ * Each snapshot is added to the aggregator as it's read, so merging is a single pass over the snapshots
+ * and only one of them is held in memory at a time.
+ * 
+ * @param aggregator The aggregator to merge the snapshots into.
+ * 
+ * @return true If all snapshots were merged successfully.
+ * @return false Otherwise. g_error is set.
+ */
+bool mergeSnapshotFiles(ConnectionAggregator& aggregator) {
+    for (const auto& snapshotFile : g_logLocations) {
+        if (!loadSnapshotFile(snapshotFile, aggregator)) {
+            cerr << "Failed to merge snapshot file " << snapshotFile << " (unreadable, corrupt, or taken "
+                 << (aggregator.isDetailed() ? "without" : "with") << " --detailed)." << endl;
+            g_error = true;
+            return false;
         }
+    }
+
+    return true;
+}
 
-        element->closedConnections++;
-        element->totalBytesSent += static_cast<size_t>(std::stoull(bytesToken));
-        element->totalSecondsWasted += std::stold(timeToken);
+/**
+ * @brief Follows the log like `tail -F`, aggregating new entries as they're written and printing a report
+ * every g_followIntervalSeconds seconds, as well as whenever SIGUSR1 is received.
+ * 
+ * The log is read from the start first, so the first report covers everything logged so far.
+ * Only returns if an error occurs; the process is meant to be stopped with SIGINT/SIGTERM.
+ * 
+ * @param aggregator The aggregator to pass the endlessh entries to.
+ * 
+ * @return false If the log couldn't be followed. g_error is set.
+ */
+bool followLog(ConnectionAggregator& aggregator) {
+    const auto& logFile = g_logLocations.front();
+
+    // SIGUSR1 stays blocked except while waiting for changes, so a report is never requested halfway through a read
+    sigset_t reportSignal{};
+    sigset_t waitMask{};
+    sigemptyset(&reportSignal);
+    sigaddset(&reportSignal, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &reportSignal, &waitMask);
+    sigdelset(&waitMask, SIGUSR1);
+
+    struct sigaction reportAction{};
+    reportAction.sa_handler = [](int32_t) { g_reportRequested = 1; };
+    sigemptyset(&reportAction.sa_mask);
+    sigaction(SIGUSR1, &reportAction, nullptr);
+
+    LogFollower follower;
+    const EndlesshLineFilter lineFilter{ aggregator };
+
+    if (!follower.open(logFile) || !follower.readNewLines(lineFilter)) {
+        cerr << "Failed to follow " << logFile << ": " << strerror(errno) << endl;
+        g_error = true;
+        return false;
     }
 
-    return returnVal;
+    const auto reportInterval = seconds(g_followIntervalSeconds);
+    auto nextReport = steady_clock::now();
+
+    while (true) {
+        if (g_reportRequested || (g_followIntervalSeconds > 0 && steady_clock::now() >= nextReport)) {
+            g_reportRequested = 0;
+            nextReport = steady_clock::now() + reportInterval;
+
+            printReport(aggregator);
+            cout << endl;
+        }
+
+        int64_t timeoutMs = -1;
+        if (g_followIntervalSeconds > 0) {
+            timeoutMs = std::max<int64_t>(0, std::chrono::duration_cast<milliseconds>(nextReport - steady_clock::now()).count());
+        }
+
+        if (follower.waitForChanges(timeoutMs, &waitMask) && !follower.readNewLines(lineFilter)) {
+            cerr << "Failed to read " << logFile << ": " << strerror(errno) << endl;
+            g_error = true;
+            return false;
+        }
+    }
 }
 
 /**
  * @brief Print basic connection statistics
  * 
+ * @param writer The writer to print to
  * @param uniqueAddresses The total amount of unique IPs stuck in the tarpit
+ * @param uniqueAddressesError The margin of error of uniqueAddresses if it's an estimate, otherwise 0
  * @param totalAccepted The total amount of accepted connections
  * @param totalClosed The total amount of closed connections
+ * @param totalAlive The total amount of connections which are still open
  * @param totalTimeWasted The total amount of time (in seconds) wasted
  * @param totalBytesSent The total amount of bytes sent to bots
  */
-void printConnectionStatistics(const uint32_t uniqueAddresses, const uint32_t totalAccepted, const uint32_t totalClosed, const double totalTimeWasted, const uint32_t totalBytesSent) {
-    // Prepare everything for markdown table while keeping the table code clean-ish
-    // I'd rather this be ugly than the table tbh
-    string tmpInt = std::to_string(uniqueAddresses);
-    string tmp = getSpacerString(18, tmpInt.size());
-    string uniqueIps = tmp + tmpInt + string(18 - tmpInt.size() - tmp.size(), ' ');
-
-    string acceptedConns;
-    tmpInt = std::to_string(totalAccepted);
-    tmp = getSpacerString(28, tmpInt.size());
-    acceptedConns = tmp + tmpInt + string(28 - tmpInt.size() - tmp.size(), ' ');
-
-
-    string closedConns;
-    tmpInt = std::to_string(totalClosed);
-    tmp = getSpacerString(26, tmpInt.size());
-    closedConns = tmp + tmpInt + string(26 - tmpInt.size() - tmp.size(), ' ');
-
-    string aliveConns;
-    if (totalAccepted >= totalClosed) {
-        tmpInt = std::to_string(totalAccepted - totalClosed);
-    } else {
-        tmpInt = std::to_string(totalClosed - totalAccepted);
-    }
-    tmp = getSpacerString(25, tmpInt.size());
-    aliveConns = tmp + tmpInt + string(25 - tmpInt.size() - tmp.size(), ' ');
-
-    cout << "# Connection Statistics" << endl;
-    cout << "| Total Unique IPs | Total Accepted Connections | Total Closed Connections | Total Alive Connections |";
+void printConnectionStatistics(ReportWriter& writer, const uint32_t uniqueAddresses, const uint32_t uniqueAddressesError, const uint32_t totalAccepted, const uint32_t totalClosed, const uint32_t totalAlive, const double totalTimeWasted, const uint32_t totalBytesSent) {
+    writer.write("# Connection Statistics").endLine();
+    writer.write("| Total Unique IPs | Total Accepted Connections | Total Closed Connections | Total Alive Connections |");
 
     if (totalTimeWasted > 0) {
-        cout << " Total Bot Time Wasted |";
+        writer.write(" Total Bot Time Wasted |");
     } if (totalBytesSent > 0) {
-        cout << " Total Bytes Sent |";
+        writer.write(" Total Bytes Sent |");
     }
-    cout << endl;
+    writer.endLine();
 
-    cout << "|------------------|----------------------------|--------------------------|-------------------------|";
+    writer.write("|------------------|----------------------------|--------------------------|-------------------------|");
 
     if (totalTimeWasted > 0) {
-        cout << "-----------------------|";
+        writer.write("-----------------------|");
     } if (totalBytesSent > 0) {
-        cout << "------------------|";
+        writer.write("------------------|");
     }
-    cout << endl;
+    writer.endLine();
+
+    const auto uniqueAddressesCell = uniqueAddressesError > 0 ? format("{0:d} ± {1:d}", uniqueAddresses, uniqueAddressesError) : format("{0:d}", uniqueAddresses);
 
-    cout << "|" << uniqueIps << "|" << acceptedConns << "|" << closedConns << "|" << aliveConns << "|";
+    writer.write('|').writeCentred(uniqueAddressesCell, 18)
+          .write('|').writeCentred(totalAccepted, 28)
+          .write('|').writeCentred(totalClosed, 26)
+          .write('|').writeCentred(totalAlive, 25)
+          .write('|');
     
     if (totalTimeWasted > 0) {
-        auto flooredSeconds = getHumanReadableTime(totalTimeWasted);
-        tmp = getSpacerString(23, flooredSeconds.size());
-        cout << tmp << flooredSeconds << string(23 - flooredSeconds.size() - tmp.size(), ' ') << '|';
+        writer.writeCentred(getHumanReadableTime(totalTimeWasted), 23).write('|');
     } if (totalBytesSent > 0) {
-        auto totalBytes = getHumanReadableBytes(totalBytesSent);
-        tmp = getSpacerString(18, totalBytes.size());
-        cout << tmp << totalBytes << string(18 - totalBytes.size() - tmp.size(), ' ') << '|';
+        writer.writeCentred(getHumanReadableBytes(totalBytesSent), 18).write('|');
     }
 
-    cout << endl;
+    writer.endLine();
 }
 
 /**
- * @brief Print the markdown header for the IP statistics table.
+ * @brief Prints a markdown table of the connections which are still open.
+ * 
+ * @param writer The writer to print to
+ * @param tracker The tracker containing the open connections
  */
-void printIpStatsTableHeader() {
+void printOpenConnections(ReportWriter& writer, const ConnectionTracker& tracker) {
+    vector<ConnectionKey> openConnections;
+    openConnections.reserve(tracker.getOpenConnections());
+    tracker.forEachOpenConnection([&openConnections](const ConnectionKey& key) { openConnections.push_back(key); });
+    std::sort(openConnections.begin(), openConnections.end());
+
+    char hostBuffer[INET6_ADDRSTRLEN];
+
+    writer.write("# Open Connections").endLine();
+    writer.write("|          Host          |  Port  |").endLine()
+          .write("|------------------------|--------|").endLine();
+
+    for (const auto& connection : openConnections) {
+        writer.write('|').writeCentred(connection.host.toChars(hostBuffer), 24)
+              .write('|').writeCentred(connection.port, 8)
+              .write('|').endLine();
+    }
+}
+
+/**
+ * @brief Prints a markdown table of the statistics per prefix (see --group-by-prefix).
+ * 
+ * @param writer The writer to print to
+ * @param aggregator The aggregated connections
+ */
+void printPrefixStats(ReportWriter& writer, const ConnectionAggregator& aggregator) {
+    auto trie = buildPrefixTrie(aggregator);
+    if (g_minPrefixHosts > 1) { trie.foldPrefixesBelow(g_minPrefixHosts); }
+
+    const auto prefixes = trie.getPrefixes();
+    char prefixBuffer[IpPrefix::MAX_CHARS];
+
+    writer.write("# Statistics per Prefix").endLine();
+
     if (!g_useDetailedInfo) {
-        cout << "# Statistics per IP" << endl;
-        cout << "|          Host          | Accepted | Closed |" << endl
-             << "|------------------------|----------|--------|" << endl;
+        writer.write("|            Prefix            |  Hosts  | Accepted | Closed |").endLine()
+              .write("|------------------------------|---------|----------|--------|").endLine();
     } else {
-        cout << "# Statistics per IP" << endl;
-        cout << "|          Host          | Accepted | Closed | Total Time (s) | Total Bytes |" << endl
-             << "|------------------------|----------|--------|----------------|-------------|" << endl;
+        writer.write("|            Prefix            |  Hosts  | Accepted | Closed | Total Time (s) | Total Bytes |").endLine()
+              .write("|------------------------------|---------|----------|--------|----------------|-------------|").endLine();
+    }
+
+    for (const auto* prefix : rankPrefixes(prefixes)) {
+        const auto& statistics = prefix->statistics;
+
+        writer.write('|').writeCentred(prefix->prefix.toChars(prefixBuffer), 30)
+              .write('|').writeCentred(statistics.hosts, 9)
+              .write('|').writeCentred(statistics.acceptedConnections, 10)
+              .write('|').writeCentred(statistics.closedConnections, 8)
+              .write('|');
+
+        if (g_useDetailedInfo) {
+            writer.writeCentred(getHumanReadableTime(statistics.getSecondsWasted()), 16)
+                  .write('|').writeCentred(getHumanReadableBytes(statistics.totalBytesSent), 13)
+                  .write('|');
+        }
+
+        writer.endLine();
     }
 }
 
 /**
- * @brief Prints the basic IP statistics table in markdown-format
+ * @brief Rolls the statistics per host up into prefixes of g_prefixLengthV4 and g_prefixLengthV6 bits.
  * 
- * @param connectionList The connection list
- * @param totalAcceptedConnections A reference to an unsigned int which will contain the total number of accepted connections.
- * @param totalClosedConnections A reference to an unsigned int which will contain the total number of closed connections.
+ * @param aggregator The aggregated connections
+ * 
+ * @return PrefixTrie The trie containing the statistics per prefix
  */
-void printIpStats(const map<string, pair<uint32_t, uint32_t>>& connectionList, uint32_t& totalAcceptedConnections, uint32_t& totalClosedConnections) {
-    for (const auto& connection : connectionList) {
-        totalAcceptedConnections += connection.second.first;
-        totalClosedConnections += connection.second.second;
-
-        if (g_printIpStatistics) {
-            string lastSpacer;
-            string tmpString;
-            const auto offset = connection.first.find("::ffff:");
-            if (offset != string::npos) {
-                tmpString = connection.first.substr(offset + 7);
-            }
-            cout << "|" << (lastSpacer = getSpacerString(24, tmpString.size()))
-                << tmpString << string(24 - tmpString.size() - lastSpacer.size(), ' ') 
-                << "|";
-
-            auto strLength = std::to_string(connection.second.first).size();
-            cout << (lastSpacer = getSpacerString(10, strLength))
-                << connection.second.first << string(10 - strLength - lastSpacer.size(), ' ')
-                << "|";
-            
-            
-            strLength = std::to_string(connection.second.second).size();
-            cout << (lastSpacer = getSpacerString(8, strLength))
-                << connection.second.second << string(8 - strLength - lastSpacer.size(), ' ')
-                << "|" << endl;
-        }
+PrefixTrie buildPrefixTrie(const ConnectionAggregator& aggregator) {
+    const auto getPrefix = [](const IpAddress& host) {
+        return IpPrefix::of(host, host.isV4() ? 96 + g_prefixLengthV4 : g_prefixLengthV6);
+    };
+
+    PrefixTrie trie;
+
+    for (const auto& connection : aggregator.getConnections()) {
+        trie.add(getPrefix(connection.first), { 1, connection.second.first, connection.second.second, 0, 0 });
+    }
+
+    for (const auto& connection : aggregator.getDetailedConnections()) {
+        trie.add(getPrefix(connection.host), {
+            1, connection.acceptedConnections, connection.closedConnections, connection.totalMillisecondsWasted, connection.totalBytesSent
+        });
     }
+
+    return trie;
 }
 
 /**
- * @brief Prints a markdown-compatible table containing detailed information, such as the total time of the bot wasted and the bytes sent.
+ * @brief Prints a markdown table of the estimated accepted connections of the hosts with the most of them (up to g_topCount).
  * 
- * @param connectionList The list of connections.
- * @param totalAccepted The total accepted connections.
- * @param totalClosed The total closed connections.
+ * @param writer The writer to print to
+ * @param statistics The estimated statistics
  */
-void printDetailedIpStats(const vector<ConnectionDetails>& connectionList, uint32_t& totalAccepted, uint32_t& totalClosed) {
-    for (const auto& connection : connectionList) {
-        totalAccepted += connection.acceptedConnections;
-        totalClosed += connection.closedConnections;
-        cout.precision(2);
-        string tmpString{};
-
-        string lastSpacer;
-        const auto offset = connection.host.find("::ffff:");
-        if (offset != string::npos) {
-            tmpString = connection.host.substr(offset + 7);
-        }
-        cout << "|" << (lastSpacer = getSpacerString(24, tmpString.size()))
-             << tmpString << string(24 - tmpString.size() - lastSpacer.size(), ' ') 
-             << "|";
-
-        auto strLength = std::to_string(connection.acceptedConnections).size();
-        cout << (lastSpacer = getSpacerString(10, strLength))
-             << connection.acceptedConnections << string(10 - strLength - lastSpacer.size(), ' ')
-             << "|";
-        
-        
-        strLength = std::to_string(connection.closedConnections).size();
-        cout << (lastSpacer = getSpacerString(8, strLength))
-             << connection.closedConnections << string(8 - strLength - lastSpacer.size(), ' ')
-             << "|";
-
-        strLength = (tmpString = getHumanReadableTime(connection.totalSecondsWasted)).size();
-        cout << (lastSpacer = getSpacerString(16, strLength))
-             << tmpString
-             << string(16 - strLength - lastSpacer.size(), ' ')
-             << "|";
-
-        
-        tmpString = getHumanReadableBytes(connection.totalBytesSent);
-        strLength = tmpString.size();
-        cout << (lastSpacer = getSpacerString(13, strLength))
-             << tmpString << string(13 - strLength - lastSpacer.size(), ' ')
-             << "|";
-
-        cout << endl;
+void printApproximateIpStats(ReportWriter& writer, const ApproximateHostStatistics& statistics) {
+    const auto topHosts = statistics.getTopHosts();
+    const auto& acceptedConnections = statistics.getAcceptedConnections();
+    char hostBuffer[INET6_ADDRSTRLEN];
+
+    writer.write("# Statistics per IP (estimated)").endLine();
+    writer.write("|          Host          | Accepted (est.) |").endLine()
+          .write("|------------------------|-----------------|").endLine();
+
+    for (size_t i = 0; i < topHosts.size() && i < g_topCount; i++) {
+        writer.write('|').writeCentred(topHosts[i].first.toChars(hostBuffer), 24)
+              .write('|').writeCentred(topHosts[i].second, 17)
+              .write('|').endLine();
+    }
+
+    writer.endLine().write(format(
+        "Estimates are never too low and, with {0:.1f}% confidence, at most {1:d} too high.",
+        CountMinSketch::getConfidence() * 100, acceptedConnections.getErrorBound()
+    )).endLine();
+}
+
+/**
+ * @brief Selects the prefix stats to report: all of them ordered by address, or the top prefixes by g_rankingField.
+ * 
+ * @param prefixes The statistics per prefix.
+ * 
+ * @return vector<const PrefixTrie::Entry*> The entries to report, in the order to report them in.
+ */
+vector<const PrefixTrie::Entry*> rankPrefixes(const vector<PrefixTrie::Entry>& prefixes) {
+    if (g_rankingField == RankingField::None) {
+        vector<const PrefixTrie::Entry*> entries;
+        entries.reserve(prefixes.size());
+        for (const auto& prefix : prefixes) { entries.push_back(&prefix); }
+
+        return entries;
     }
+
+    // Distinct ports aren't rolled up (see parseArgs)
+    return selectTopEntries(prefixes, g_topCount, [](const PrefixTrie::Entry& prefix) -> uint64_t {
+        switch (g_rankingField) {
+            case RankingField::Closed: return prefix.statistics.closedConnections;
+            case RankingField::TimeWasted: return prefix.statistics.totalMillisecondsWasted;
+            case RankingField::BytesSent: return prefix.statistics.totalBytesSent;
+            default: return prefix.statistics.acceptedConnections;
+        }
+    });
 }
 
 /**
@@ -597,7 +1195,7 @@ int32_t parseArgs(const int32_t& argc, char** argv) {
                     cerr << "Missing path to new syslog!" << endl;
                     return 1;
                 }
-                g_logLocation = optarg;
+                addLogLocations(optarg);
                 break;
             case 's':
                 g_readFromStdIn = true;
@@ -614,8 +1212,401 @@ int32_t parseArgs(const int32_t& argc, char** argv) {
             case 'v':
                 cout << getAppVersionText() << endl;
                 return 1;
+            case 'f':
+                if (optarg == nullptr) {
+                    cerr << "Missing path to state file!" << endl;
+                    return 1;
+                }
+                g_stateFile = optarg;
+                break;
+            case 'e':
+                if (optarg == nullptr) {
+                    cerr << "Missing path to snapshot file!" << endl;
+                    return 1;
+                }
+                g_exportFile = optarg;
+                break;
+            case 'b':
+            case 'u':
+                if (optarg == nullptr || !parseTimeArgument(optarg, optVal == 'u', optVal == 'b' ? g_timeWindow.since : g_timeWindow.until)) {
+                    cerr << "Invalid time! Use e.g. 2023-10-16, \"2023-10-16 12:00:00\" or 24h (s/m/h/d/w ago)" << endl;
+                    return 1;
+                }
+                break;
+            case 'o':
+                g_printOpenConnections = true;
+                break;
+            case 'T': {
+                char* end = nullptr;
+                const auto topCount = optarg == nullptr ? 0 : std::strtoull(optarg, &end, 10);
+
+                if (optarg == nullptr || *end != '\0' || topCount == 0) {
+                    cerr << "Invalid amount of hosts!" << endl;
+                    return 1;
+                }
+
+                g_topCount = static_cast<size_t>(topCount);
+                break;
+            }
+            case 'k':
+                if (optarg == nullptr || !parseRankingField(optarg, g_rankingField)) {
+                    cerr << "Invalid field to sort by! Use one of accepted, closed, ports, time or bytes" << endl;
+                    return 1;
+                }
+                break;
+            case 'm':
+                g_mergeSnapshots = true;
+                break;
+            case 'p':
+                g_profile = true;
+                break;
+            case 'A':
+                g_approximate = true;
+                break;
+            case 'g':
+                if (optarg == nullptr || !parsePrefixLengths(optarg)) {
+                    cerr << "Invalid prefix lengths! Use e.g. 24 or 24,48 (IPv4: 0 - 32, IPv6: 0 - 128)" << endl;
+                    return 1;
+                }
+                g_groupByPrefix = true;
+                break;
+            case 'x':
+            case 'w':
+                if (optarg == nullptr || !g_hostFilter.addList(optarg, optVal == 'w')) {
+                    cerr << "Invalid prefix! Use e.g. 203.0.113.0/24,2001:db8::/32" << endl;
+                    return 1;
+                }
+                break;
+            case 'X':
+            case 'W': {
+                string errorMessage;
+
+                if (optarg == nullptr || !g_hostFilter.addFile(optarg, optVal == 'W', errorMessage)) {
+                    cerr << (optarg == nullptr ? "Missing path to prefix file!" : errorMessage) << endl;
+                    return 1;
+                }
+                break;
+            }
+            case 'P':
+                if (optarg == nullptr) {
+                    cerr << "Missing path prefix of the CSV files!" << endl;
+                    return 1;
+                }
+                g_abuseIpDbSplitPrefix = optarg;
+                g_printAbuseIpDbCsv = true;
+                break;
+            case 'r':
+                if (optarg == nullptr) {
+                    cerr << "Missing path to reported-host index!" << endl;
+                    return 1;
+                }
+                g_reportedIndexFile = optarg;
+                break;
+            case 'R':
+                if (optarg == nullptr || !parseDuration(optarg, g_reportCooldownSeconds)) {
+                    cerr << "Invalid cooldown! Use e.g. 15m, 24h or 7d" << endl;
+                    return 1;
+                }
+                g_reportCooldownOverridden = true;
+                break;
+            case 'M': {
+                char* end = nullptr;
+                const auto minHosts = optarg == nullptr ? 0 : std::strtoul(optarg, &end, 10);
+
+                if (optarg == nullptr || *end != '\0' || minHosts == 0 || minHosts > UINT32_MAX) {
+                    cerr << "Invalid amount of hosts!" << endl;
+                    return 1;
+                }
+
+                g_minPrefixHosts = static_cast<uint32_t>(minHosts);
+                break;
+            }
+            case 'j':
+                if (optarg == nullptr) {
+                    cerr << "Missing path to profile file!" << endl;
+                    return 1;
+                }
+                g_profile = true;
+                g_profileJsonFile = optarg;
+                break;
+            case 'F': {
+                char* end = nullptr;
+                const auto interval = optarg == nullptr ? 0 : std::strtol(optarg, &end, 10);
+
+                if (optarg == nullptr || *end != '\0' || interval < 0) {
+                    cerr << "Invalid report interval!" << endl;
+                    return 1;
+                }
+
+                g_followIntervalSeconds = interval;
+                break;
+            }
+            case 't': {
+                char* end = nullptr;
+                const auto threadCount = optarg == nullptr ? 0 : std::strtoull(optarg, &end, 10);
+
+                if (optarg == nullptr || *end != '\0' || threadCount > MAX_THREADS) {
+                    cerr << "Invalid thread count! Use 0 - " << MAX_THREADS << endl;
+                    return 1;
+                }
+
+                // 0 means one thread per core
+                g_threadCount = threadCount == 0 ? std::max(1u, std::thread::hardware_concurrency()) : static_cast<uint32_t>(threadCount);
+                break;
+            }
         }
     }
 
+    // Any remaining arguments are additional log files (e.g. an unquoted glob expanded by the shell)
+    for (; optind < argc; optind++) {
+        addLogLocations(argv[optind]);
+    }
+
+    if (!g_stateFile.empty() && (g_readFromStdIn || g_logLocations.size() != 1)) {
+        cerr << "--state requires exactly one log file and can't be used with --stdin!" << endl;
+        return 1;
+    }
+
+    if (g_followIntervalSeconds >= 0 && (g_readFromStdIn || !g_stateFile.empty() || g_logLocations.size() != 1)) {
+        cerr << "--follow requires exactly one log file and can't be used with --stdin or --state!" << endl;
+        return 1;
+    }
+
+    if (g_profile && g_followIntervalSeconds >= 0) {
+        cerr << "--profile can't be used with --follow!" << endl;
+        return 1;
+    }
+
+    if (g_mergeSnapshots && (!g_logLocationsOverridden || g_readFromStdIn || !g_stateFile.empty() || g_followIntervalSeconds >= 0)) {
+        cerr << "--merge requires at least one snapshot file and can't be used with --stdin, --state or --follow!" << endl;
+        return 1;
+    }
+
+    if (g_threadCount > 1 && (g_readFromStdIn || !g_stateFile.empty() || g_followIntervalSeconds >= 0 || g_mergeSnapshots)) {
+        cerr << "--threads can't be used with --stdin, --state, --follow or --merge!" << endl;
+        return 1;
+    }
+
+    if (g_timeWindow.isRestricted() && (g_mergeSnapshots || !g_stateFile.empty() || g_timeWindow.since > g_timeWindow.until)) {
+        cerr << "--since/--until can't be used with --merge or --state, and --since must not lie after --until!" << endl;
+        return 1;
+    }
+
+    if (g_approximate && (g_useDetailedInfo || g_printAbuseIpDbCsv || g_printOpenConnections || g_mergeSnapshots || !g_stateFile.empty() || !g_exportFile.empty())) {
+        cerr << "--approximate can't be used with --detailed, --abuse-ipdb, --open-connections, --merge, --state or --export!" << endl;
+        return 1;
+    }
+
+    if (g_groupByPrefix && (g_approximate || g_printAbuseIpDbCsv || g_rankingField == RankingField::Ports)) {
+        cerr << "--group-by-prefix can't be used with --approximate, --abuse-ipdb or --sort-by ports!" << endl;
+        return 1;
+    }
+
+    // Each report would overwrite the files of the previous one, possibly while they're being uploaded
+    if (!g_abuseIpDbSplitPrefix.empty() && g_followIntervalSeconds >= 0) {
+        cerr << "--abuse-ipdb-split can't be used with --follow!" << endl;
+        return 1;
+    }
+
+    // The index stays locked while it's open, and following the log never returns to close it
+    if (!g_reportedIndexFile.empty() && (!g_printAbuseIpDbCsv || g_followIntervalSeconds >= 0)) {
+        cerr << "--reported-index requires --abuse-ipdb and can't be used with --follow!" << endl;
+        return 1;
+    }
+
+    if (g_reportCooldownOverridden && g_reportedIndexFile.empty()) {
+        cerr << "--report-cooldown requires --reported-index!" << endl;
+        return 1;
+    }
+
+    if (g_hostFilter.isActive() && g_mergeSnapshots) {
+        cerr << "--exclude-cidr/--include-cidr can't be used with --merge!" << endl;
+        return 1;
+    }
+
+    g_hostFilter.compile();
+
+    if (g_minPrefixHosts > 0 && !g_groupByPrefix) {
+        cerr << "--min-hosts requires --group-by-prefix!" << endl;
+        return 1;
+    }
+
+    if (g_approximate && (g_topCount == 0 || (g_topCount != SIZE_MAX && g_topCount > ApproximateHostStatistics::HEAVY_HITTER_CAPACITY))) {
+        cerr << "--approximate can report at most the top " << ApproximateHostStatistics::HEAVY_HITTER_CAPACITY << " hosts!" << endl;
+        return 1;
+    }
+
+    if (g_approximate && g_rankingField != RankingField::None && g_rankingField != RankingField::Accepted) {
+        cerr << "--approximate can only rank hosts by accepted connections!" << endl;
+        return 1;
+    }
+
+    // --approximate reports the top 100 hosts, unless told otherwise
+    if (g_approximate && g_topCount == SIZE_MAX) { g_topCount = 100; }
+
+    // --top alone reports the hosts with the most accepted connections
+    if (g_topCount != SIZE_MAX && g_rankingField == RankingField::None) { g_rankingField = RankingField::Accepted; }
+
+    if (!g_useDetailedInfo && g_rankingField != RankingField::None && g_rankingField != RankingField::Accepted && g_rankingField != RankingField::Closed) {
+        cerr << "Sorting by ports, time or bytes requires --detailed!" << endl;
+        return 1;
+    }
+
+    if (!g_mergeSnapshots) { sortLogLocationsChronologically(); }
+
     return 0;
 }
+
+/**
+ * @brief Parses the argument of --group-by-prefix: the IPv4 prefix length, optionally followed by the IPv6 one (e.g. 24,48).
+ * 
+ * @param argument The argument to parse.
+ * 
+ * @return true If the argument was parsed successfully; g_prefixLengthV4 and g_prefixLengthV6 are set.
+ * @return false Otherwise.
+ */
+bool parsePrefixLengths(const char* argument) {
+    char* end = nullptr;
+    const auto lengthV4 = std::strtoul(argument, &end, 10);
+    if (end == argument || lengthV4 > 32) { return false; }
+
+    auto lengthV6 = static_cast<unsigned long>(g_prefixLengthV6);
+    if (*end == ',') {
+        const auto* lengthV6Start = end + 1;
+        lengthV6 = std::strtoul(lengthV6Start, &end, 10);
+        if (end == lengthV6Start || lengthV6 > 128) { return false; }
+    }
+
+    if (*end != '\0') { return false; }
+
+    g_prefixLengthV4 = static_cast<uint32_t>(lengthV4);
+    g_prefixLengthV6 = static_cast<uint32_t>(lengthV6);
+    return true;
+}
+
+/**
+ * @brief Parses the argument of --since or --until into local wall-clock time (@see SyslogTimestampParser).
+ * 
+ * Accepts a date and optional time (2023-10-16, "2023-10-16 12:00", 2023-10-16T12:00:00)
+ * or a duration relative to now (30s, 15m, 24h, 7d, 2w).
+ * 
+ * @param argument The argument to parse.
+ * @param isEnd Whether the argument is the end of a window; a date without a time then includes the entire day.
+ * @param timestamp Will contain the parsed time.
+ * 
+ * @return true If the argument was parsed successfully.
+ * @return false Otherwise.
+ */
+bool parseTimeArgument(const char* argument, const bool isEnd, int64_t& timestamp) {
+    const string_view str(argument);
+
+    if (SyslogTimestampParser::parseRfc3339(str, timestamp)) {
+        if (isEnd && str.size() == 10) { timestamp += 86400 - 1; }
+        return true;
+    }
+
+    int64_t seconds = 0;
+    if (!parseDuration(argument, seconds)) { return false; }
+
+    timestamp = getLocalWallClockNow() - seconds;
+    return true;
+}
+
+/**
+ * @brief Parses a duration: an amount followed by a unit (30s, 15m, 24h, 7d, 2w).
+ * 
+ * @param argument The argument to parse.
+ * @param seconds Will contain the duration in seconds.
+ * 
+ * @return true If the argument was parsed successfully.
+ * @return false Otherwise.
+ */
+bool parseDuration(const char* argument, int64_t& seconds) {
+    char* unit = nullptr;
+    const auto amount = std::strtoll(argument, &unit, 10);
+    if (unit == argument || amount < 0 || unit[0] == '\0' || unit[1] != '\0') { return false; }
+
+    int64_t unitSeconds = 0;
+    switch (unit[0]) {
+        case 's': unitSeconds = 1; break;
+        case 'm': unitSeconds = 60; break;
+        case 'h': unitSeconds = 3600; break;
+        case 'd': unitSeconds = 86400; break;
+        case 'w': unitSeconds = 7 * 86400; break;
+        default: return false;
+    }
+
+    seconds = amount * unitSeconds;
+    return true;
+}
+
+/**
+ * @brief Sorts the log files oldest first, so connections spanning a rotation are paired up correctly.
+ * 
+ * Logs are ordered by their modification time. Logs modified at the same time are ordered by their rotation suffix,
+ * e.g. syslog.2.gz, syslog.1, syslog.
+ */
+void sortLogLocationsChronologically() {
+    if (g_logLocations.size() < 2) { return; }
+
+    struct LogFileOrder {
+        int64_t     modificationTime; //!< The modification time, in nanoseconds
+        uint64_t    rotationIndex; //!< The rotation suffix + 1, or 0 if there is none
+        string      path; //!< The path of the log
+    };
+
+    vector<LogFileOrder> logFiles;
+    for (auto& path : g_logLocations) {
+        struct stat fileInfo{};
+        const auto modificationTime = stat(path.c_str(), &fileInfo) == 0
+            ? static_cast<int64_t>(fileInfo.st_mtim.tv_sec) * 1000000000 + fileInfo.st_mtim.tv_nsec
+            : 0;
+
+        string_view name(path);
+        if (name.size() > 3 && name.substr(name.size() - 3) == ".gz") { name.remove_suffix(3); }
+
+        uint64_t rotationIndex = 0;
+        const auto separator = name.find_last_of('.');
+        if (separator != string_view::npos && separator + 1 < name.size() && std::all_of(name.begin() + separator + 1, name.end(), ::isdigit)) {
+            rotationIndex = std::strtoull(name.data() + separator + 1, nullptr, 10) + 1;
+        }
+
+        logFiles.push_back({ modificationTime, rotationIndex, std::move(path) });
+    }
+
+    std::stable_sort(logFiles.begin(), logFiles.end(), [](const LogFileOrder& a, const LogFileOrder& b) {
+        return a.modificationTime != b.modificationTime ? a.modificationTime < b.modificationTime : a.rotationIndex > b.rotationIndex;
+    });
+
+    for (size_t i = 0; i < logFiles.size(); i++) {
+        g_logLocations[i] = std::move(logFiles[i].path);
+    }
+}
+
+/**
+ * @brief Adds the files matching a path or glob pattern to the list of logs to read.
+ * 
+ * The first call replaces the default log location. Patterns which match no files are kept as-is,
+ * so reading them later produces a meaningful error.
+ * 
+ * @param pattern The path or glob pattern, e.g. /var/log/syslog* 
+ */
+void addLogLocations(const char* pattern) {
+    if (!g_logLocationsOverridden) {
+        g_logLocations.clear();
+        g_logLocationsOverridden = true;
+    }
+
+    glob_t globResult{};
+    if (glob(pattern, GLOB_NOCHECK | GLOB_TILDE, nullptr, &globResult) != 0) {
+        g_logLocations.emplace_back(pattern);
+        globfree(&globResult);
+        return;
+    }
+
+    for (size_t i = 0; i < globResult.gl_pathc; i++) {
+        g_logLocations.emplace_back(globResult.gl_pathv[i]);
+    }
+
+    globfree(&globResult);
+}
\ No newline at end of file